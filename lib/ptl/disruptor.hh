@@ -0,0 +1,397 @@
+#ifndef PTL_DISRUPTOR_HH
+#define PTL_DISRUPTOR_HH
+
+#include <ptl/object_pool.hh>
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+ * Disruptor
+ * A preallocated ring of objects which are reused in place: a
+ * producer claims a sequence number, fills the object of this slot
+ * in place and publishes the sequence.  Consumers read (or modify)
+ * the objects in place and release the processed sequences in
+ * batches.  So there is no construction or copy per object.
+ * Consumers can depend on other consumers (e.g. B on A): B only
+ * sees the sequences which A has released - so A can prepare the
+ * objects for B.  Independent consumers all see all objects
+ * (fan-out).  A producer can only reuse a slot when all consumers
+ * have released it.
+ * The following behaviour is configurable with the help of the
+ * different policies:
+ * o producer::single / producer::multi
+ * o wait::yield / wait::blocking
+ *
+ * Usage:
+ *    ring< T > r( 1024 );
+ *    ring< T >::consumer & a( r.add_consumer() );
+ *    ring< T >::consumer & b( r.add_consumer( { &a } ) );
+ *    // Producer
+ *    std::int64_t const seq( r.claim() );
+ *    r[ seq ].fill( ... );
+ *    r.publish( seq );
+ *    // Consumer (same for b)
+ *    while( true ) {
+ *       std::int64_t const last( a.wait() );
+ *       if( last < a.next() ) break;  // halted and drained
+ *       for( std::int64_t s( a.next() ); s <= last; ++s ) {
+ *          work_on( r[ s ] );
+ *       }
+ *       a.release( last );
+ *    }
+ */
+namespace ptl { namespace disruptor {
+
+namespace detail {
+
+// A sequence number in its own cache line.
+class sequence {
+public:
+   sequence( std::int64_t const value = -1 )
+      : value_( value ) {
+   }
+
+   std::int64_t get() const {
+      return value_.load( std::memory_order_acquire );
+   }
+
+   void set( std::int64_t const value ) {
+      value_.store( value, std::memory_order_release );
+   }
+
+private:
+   char pad_0_[ object_pool::detail::cache_line_size ];
+   std::atomic< std::int64_t > value_;
+   char pad_1_[ object_pool::detail::cache_line_size ];
+};
+
+}
+
+namespace policies {
+
+/*
+ * o producer::single / producer::multi:
+ *   single must only be used by one producer thread; multi lets
+ *   any number of threads claim and publish concurrently.
+ *   claim( n ) returns the last of the n claimed sequences,
+ *   published( from ) the highest sequence up to which all
+ *   sequences starting at 'from' are published (from - 1 when
+ *   'from' is not yet published).
+ */
+namespace producer {
+
+class single {
+public:
+   single( std::size_t const )
+      : next_( 0 ),
+        cursor_( -1 ) {
+   }
+
+   std::int64_t claim( std::size_t const n ) {
+      next_ += static_cast< std::int64_t >( n );
+      return next_ - 1;
+   }
+
+   void publish( std::int64_t const, std::int64_t const last ) {
+      cursor_.set( last );
+   }
+
+   std::int64_t published( std::int64_t const ) const {
+      return cursor_.get();
+   }
+
+private:
+   // Only used by the producer thread.
+   std::int64_t next_;
+   detail::sequence cursor_;
+};
+
+/*
+ * The producers claim with one atomic add; as they publish in any
+ * order, each slot stores the sequence which was last published
+ * into it.
+ */
+class multi {
+public:
+   multi( std::size_t const size )
+      : mask_( size - 1 ),
+        claimed_( 0 ),
+        published_( new std::atomic< std::int64_t >[ size ] ) {
+      for( std::size_t i( 0 ); i < size; ++i ) {
+         published_[ i ].store( -1, std::memory_order_relaxed );
+      }
+   }
+
+   std::int64_t claim( std::size_t const n ) {
+      return claimed_.fetch_add(
+         static_cast< std::int64_t >( n ), std::memory_order_relaxed )
+         + static_cast< std::int64_t >( n ) - 1;
+   }
+
+   void publish( std::int64_t const first, std::int64_t const last ) {
+      for( std::int64_t s( first ); s <= last; ++s ) {
+         slot( s ).store( s, std::memory_order_release );
+      }
+   }
+
+   std::int64_t published( std::int64_t const from ) const {
+      std::int64_t const claimed(
+         claimed_.load( std::memory_order_acquire ) );
+      std::int64_t s( from );
+      while( s < claimed
+             and slot( s ).load( std::memory_order_acquire ) == s ) {
+         ++s;
+      }
+      return s - 1;
+   }
+
+private:
+   std::atomic< std::int64_t > & slot( std::int64_t const s ) const {
+      return published_[ static_cast< std::size_t >( s ) & mask_ ];
+   }
+
+   std::size_t const mask_;
+   char pad_0_[ object_pool::detail::cache_line_size ];
+   std::atomic< std::int64_t > claimed_;
+   char pad_1_[ object_pool::detail::cache_line_size ];
+   std::unique_ptr< std::atomic< std::int64_t >[] > const published_;
+};
+
+}
+
+/*
+ * o wait::yield / wait::blocking:
+ *   How producers (ring full) and consumers (nothing available)
+ *   wait.  wait( ready ) returns when ready() is true; signal() is
+ *   called after each publish, release and halt.
+ *   yield spins a short time and then yields the CPU: lowest
+ *   latency, but it burns CPU.  blocking parks the waiting threads
+ *   on a condition variable; the signalling thread only takes the
+ *   mutex when somebody waits.
+ */
+namespace wait {
+
+class yield {
+public:
+   template< typename READY >
+   void wait( READY ready ) {
+      for( unsigned long i( 0 ); not ready(); ++i ) {
+         if( i < 100 ) {
+            object_pool::detail::cpu_relax();
+         } else {
+            std::this_thread::yield();
+         }
+      }
+   }
+
+   void signal() {
+   }
+};
+
+class blocking {
+public:
+   blocking()
+      : waiters_( 0 ) {
+   }
+
+   template< typename READY >
+   void wait( READY ready ) {
+      if( ready() ) {
+         return;
+      }
+      std::unique_lock< std::mutex > guard( mutex_ );
+      waiters_.fetch_add( 1, std::memory_order_relaxed );
+      std::atomic_thread_fence( std::memory_order_seq_cst );
+      while( not ready() ) {
+         cv_.wait( guard );
+      }
+      waiters_.fetch_sub( 1, std::memory_order_relaxed );
+   }
+
+   void signal() {
+      std::atomic_thread_fence( std::memory_order_seq_cst );
+      if( waiters_.load( std::memory_order_relaxed ) != 0 ) {
+         std::lock_guard< std::mutex > guard( mutex_ );
+         cv_.notify_all();
+      }
+   }
+
+private:
+   std::atomic< long > waiters_;
+   std::mutex mutex_;
+   std::condition_variable cv_;
+};
+
+}
+
+}
+
+template< typename OBJ_TYPE,
+          typename POLICIY_PRODUCER = policies::producer::multi,
+          typename POLICIY_WAIT = policies::wait::yield >
+class ring {
+public:
+   /*
+    * One consumer (stage) of the ring: it is used by one thread.
+    * Each consumer sees every published sequence - but only after
+    * all the consumers it depends on have released it.
+    */
+   class consumer {
+   public:
+      consumer( consumer const & ) = delete;
+      consumer & operator=( consumer const & ) = delete;
+
+      // The next sequence which this consumer has to process.
+      std::int64_t next() const {
+         return next_;
+      }
+
+      /*
+       * Waits until next() can be processed and returns the highest
+       * sequence which can be processed now (so a batch can be
+       * processed at once).  When the ring was halted and this
+       * consumer has processed everything, next() - 1 is returned.
+       */
+      std::int64_t wait() {
+         std::int64_t rval( next_ - 1 );
+         ring_.wait_.wait( [this, &rval]() {
+               bool const halted(
+                  ring_.halted_.load( std::memory_order_acquire ) );
+               std::int64_t const published(
+                  ring_.producer_.published( next_ ) );
+               std::int64_t available( published );
+               for( consumer const * const d : depends_on_ ) {
+                  available = std::min( available, d->sequence_.get() );
+               }
+               if( available >= next_ ) {
+                  rval = available;
+                  return true;
+               }
+               return halted and published < next_;
+            } );
+         return rval;
+      }
+
+      // All sequences up to 'last' are processed: the objects can be
+      // used by dependent consumers and reused by the producers.
+      void release( std::int64_t const last ) {
+         sequence_.set( last );
+         next_ = last + 1;
+         ring_.wait_.signal();
+      }
+
+      // The last released sequence.
+      std::int64_t sequence() const {
+         return sequence_.get();
+      }
+
+   private:
+      consumer( ring & r, std::vector< consumer const * > const & deps )
+         : ring_( r ),
+           depends_on_( deps ),
+           next_( 0 ) {
+      }
+
+      ring & ring_;
+      std::vector< consumer const * > const depends_on_;
+      // Only used by the consumer thread.
+      std::int64_t next_;
+      detail::sequence sequence_;
+
+      friend class ring;
+   };
+
+   // The size is rounded up to the next power of two.
+   ring( std::size_t const min_size )
+      : size_( object_pool::detail::round_up_pow2( min_size ) ),
+        mask_( size_ - 1 ),
+        entries_( new OBJ_TYPE[ size_ ] ),
+        producer_( size_ ),
+        halted_( false ) {
+   }
+
+   ring( ring const & ) = delete;
+   ring & operator=( ring const & ) = delete;
+
+   std::size_t size() const {
+      return size_;
+   }
+
+   // All consumers must be added before the first claim.
+   consumer & add_consumer(
+      std::vector< consumer const * > const & depends_on
+         = std::vector< consumer const * >() ) {
+      consumers_.emplace_back( new consumer( *this, depends_on ) );
+      return *consumers_.back();
+   }
+
+   // Claims one sequence: waits until its slot is released by all
+   // consumers.
+   std::int64_t claim() {
+      return claim( 1 );
+   }
+
+   // Claims n (at most size()) sequences and returns the last one;
+   // the first is the returned one - n + 1.
+   std::int64_t claim( std::size_t const n ) {
+      if( n == 0 or n > size_ ) {
+         // Programming bug: this could never be satisfied.
+         abort();
+      }
+      std::int64_t const last( producer_.claim( n ) );
+      std::int64_t const wrap( last - static_cast< std::int64_t >( size_ ) );
+      wait_.wait( [this, wrap]() { return min_consumer_sequence() >= wrap; } );
+      return last;
+   }
+
+   // The object of the slot of the given sequence.
+   OBJ_TYPE & operator[]( std::int64_t const seq ) {
+      return entries_[ static_cast< std::size_t >( seq ) & mask_ ];
+   }
+
+   void publish( std::int64_t const seq ) {
+      publish( seq, seq );
+   }
+
+   void publish( std::int64_t const first, std::int64_t const last ) {
+      producer_.publish( first, last );
+      wait_.signal();
+   }
+
+   // Must be called after the last publish: the consumers process
+   // everything which was published and then stop.
+   void halt() {
+      halted_.store( true, std::memory_order_release );
+      wait_.signal();
+   }
+
+private:
+   std::int64_t min_consumer_sequence() const {
+      std::int64_t rval( std::numeric_limits< std::int64_t >::max() );
+      for( std::unique_ptr< consumer > const & c : consumers_ ) {
+         rval = std::min( rval, c->sequence_.get() );
+      }
+      return rval;
+   }
+
+   std::size_t const size_;
+   std::size_t const mask_;
+   std::unique_ptr< OBJ_TYPE[] > const entries_;
+   POLICIY_PRODUCER producer_;
+   POLICIY_WAIT wait_;
+   std::atomic< bool > halted_;
+   std::vector< std::unique_ptr< consumer > > consumers_;
+};
+
+}}
+
+#endif
@@ -0,0 +1,319 @@
+#ifndef PTL_EXECUTOR_HH
+#define PTL_EXECUTOR_HH
+
+#include <ptl/object_pool.hh>
+
+#include <cstdlib>
+#include <future>
+#include <iterator>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/*
+ * Executor
+ * A thread pool which runs callables on a fixed number of worker
+ * threads.  The tasks are passed to the workers with an
+ * object_pool::pool (POOL) - so the queueing (container, size
+ * handling, notify, stats) is configured with the pool policies.
+ * Small callables (e.g. lambdas which capture some pointers) are
+ * stored in the task itself: posting them does not allocate memory.
+ *
+ * Usage:
+ *    thread_pool<> tp( 4, size_handling::unlimited() );
+ *    tp.post( [&]() { work(); } );
+ *    std::future< int > f( tp.submit( []() { return 42; } ) );
+ *    tp.drain();  // runs everything which was posted; joins
+ */
+namespace ptl { namespace executor {
+
+/*
+ * Move only type erased 'void ()' callable.  Callables which are at
+ * most BUFFER_SIZE bytes large (and can be moved without throwing)
+ * are stored inline; larger ones on the heap.
+ */
+template< std::size_t BUFFER_SIZE >
+class basic_task {
+public:
+   basic_task()
+      : ops_( nullptr ) {
+   }
+
+   template< typename FUNC,
+             typename = typename std::enable_if<
+                not std::is_same< typename std::decay< FUNC >::type,
+                                  basic_task >::value >::type >
+   basic_task( FUNC && f )
+      : ops_( nullptr ) {
+      construct< typename std::decay< FUNC >::type >(
+         std::forward< FUNC >( f ),
+         std::integral_constant<
+            bool, fits_inline< typename std::decay< FUNC >::type >() >() );
+   }
+
+   basic_task( basic_task && other )
+      : ops_( other.ops_ ) {
+      if( ops_ != nullptr ) {
+         ops_->move( &other.storage_, &storage_ );
+         other.ops_ = nullptr;
+      }
+   }
+
+   basic_task & operator=( basic_task && other ) {
+      if( this != &other ) {
+         reset();
+         if( other.ops_ != nullptr ) {
+            other.ops_->move( &other.storage_, &storage_ );
+            ops_ = other.ops_;
+            other.ops_ = nullptr;
+         }
+      }
+      return *this;
+   }
+
+   ~basic_task() {
+      reset();
+   }
+
+   basic_task( basic_task const & ) = delete;
+   basic_task & operator=( basic_task const & ) = delete;
+
+   void operator()() {
+      if( ops_ == nullptr ) {
+         // Programming bug: there is no callable.
+         abort();
+      }
+      ops_->invoke( &storage_ );
+   }
+
+   explicit operator bool() const {
+      return ops_ != nullptr;
+   }
+
+   // True when a FUNC is stored without allocating memory.
+   template< typename FUNC >
+   static constexpr bool fits_inline() {
+      return sizeof( FUNC ) <= BUFFER_SIZE
+         and alignof( FUNC ) <= alignof( storage_type )
+         and std::is_nothrow_move_constructible< FUNC >::value;
+   }
+
+private:
+   using storage_type = typename std::aligned_storage< BUFFER_SIZE >::type;
+
+   class ops {
+   public:
+      void ( *invoke )( void * );
+      // Moves from the first to the second storage and destroys the
+      // source.
+      void ( *move )( void *, void * );
+      void ( *destroy )( void * );
+   };
+
+   template< typename FUNC >
+   class inline_ops {
+   public:
+      static void invoke( void * p ) {
+         ( *static_cast< FUNC * >( p ) )();
+      }
+
+      static void move( void * from, void * to ) {
+         new( to ) FUNC( std::move( *static_cast< FUNC * >( from ) ) );
+         static_cast< FUNC * >( from )->~FUNC();
+      }
+
+      static void destroy( void * p ) {
+         static_cast< FUNC * >( p )->~FUNC();
+      }
+
+      static ops const table;
+   };
+
+   // The storage holds a pointer to the callable.
+   template< typename FUNC >
+   class heap_ops {
+   public:
+      static void invoke( void * p ) {
+         ( **static_cast< FUNC ** >( p ) )();
+      }
+
+      static void move( void * from, void * to ) {
+         new( to ) FUNC *( *static_cast< FUNC ** >( from ) );
+      }
+
+      static void destroy( void * p ) {
+         delete *static_cast< FUNC ** >( p );
+      }
+
+      static ops const table;
+   };
+
+   template< typename FUNC, typename ARG >
+   void construct( ARG && f, std::true_type ) {
+      new( &storage_ ) FUNC( std::forward< ARG >( f ) );
+      ops_ = &inline_ops< FUNC >::table;
+   }
+
+   template< typename FUNC, typename ARG >
+   void construct( ARG && f, std::false_type ) {
+      new( &storage_ ) FUNC *( new FUNC( std::forward< ARG >( f ) ) );
+      ops_ = &heap_ops< FUNC >::table;
+   }
+
+   void reset() {
+      if( ops_ != nullptr ) {
+         ops_->destroy( &storage_ );
+         ops_ = nullptr;
+      }
+   }
+
+   ops const * ops_;
+   storage_type storage_;
+};
+
+template< std::size_t BUFFER_SIZE >
+template< typename FUNC >
+typename basic_task< BUFFER_SIZE >::ops const
+basic_task< BUFFER_SIZE >::inline_ops< FUNC >::table = {
+   &inline_ops< FUNC >::invoke,
+   &inline_ops< FUNC >::move,
+   &inline_ops< FUNC >::destroy };
+
+template< std::size_t BUFFER_SIZE >
+template< typename FUNC >
+typename basic_task< BUFFER_SIZE >::ops const
+basic_task< BUFFER_SIZE >::heap_ops< FUNC >::table = {
+   &heap_ops< FUNC >::invoke,
+   &heap_ops< FUNC >::move,
+   &heap_ops< FUNC >::destroy };
+
+// With the pointer to the operations a task fills one cache line.
+using task = basic_task< object_pool::detail::cache_line_size
+                         - sizeof( void * ) >;
+
+using default_pool = object_pool::pool<
+   task,
+   object_pool::policies::threading::multi,
+   object_pool::policies::notify::one,
+   object_pool::policies::notify::one,
+   object_pool::policies::termination::terminatable,
+   object_pool::policies::container::segmented,
+   object_pool::policies::size_handling::unlimited >;
+
+/*
+ * Runs the tasks of POOL (its value_type must be a task) on a fixed
+ * number of workers.  Each worker pops up to POP_BATCH tasks at once:
+ * larger batches reduce the contention on the pool but a worker
+ * might hold back tasks which other (idle) workers could run.
+ * The thread pool is the only terminator of POOL; posting must not
+ * happen concurrently with or after drain().
+ */
+template< typename POOL = default_pool, std::size_t POP_BATCH = 1 >
+class thread_pool {
+public:
+   using task_type = typename POOL::value_type;
+
+   static_assert( POP_BATCH >= 1, "workers must pop at least one task" );
+
+   // The pool is constructed with the pool_args.
+   template< typename ... ARGS >
+   thread_pool( std::size_t const workers, ARGS && ... pool_args )
+      : pool_( std::forward< ARGS >( pool_args ) ... ),
+        drained_( false ) {
+      if( workers == 0 ) {
+         // Programming bug: nobody would run the tasks.
+         abort();
+      }
+      pool_.register_terminator();
+      pool_.start();
+      for( std::size_t i( 0 ); i < workers; ++i ) {
+         workers_.emplace_back( [this]() { work(); } );
+      }
+   }
+
+   ~thread_pool() {
+      drain();
+   }
+
+   thread_pool( thread_pool const & ) = delete;
+   thread_pool & operator=( thread_pool const & ) = delete;
+
+   std::size_t workers() const {
+      return workers_.size();
+   }
+
+   // The callable must not throw (like the function of a
+   // std::thread); use submit() to get the exceptions.
+   template< typename FUNC >
+   void post( FUNC && f ) {
+      pool_.emplace( std::forward< FUNC >( f ) );
+   }
+
+   // Returns the future of the result (or exception) of f().
+   template< typename FUNC >
+   std::future< typename std::result_of<
+                   typename std::decay< FUNC >::type () >::type >
+   submit( FUNC && f ) {
+      using result_type = typename std::result_of<
+         typename std::decay< FUNC >::type () >::type;
+      std::packaged_task< result_type () > pt( std::forward< FUNC >( f ) );
+      std::future< result_type > rval( pt.get_future() );
+      pool_.emplace( std::move( pt ) );
+      return rval;
+   }
+
+   /*
+    * Posts all callables of [first, last) with one lock acquisition
+    * (as long as the pool does not get full).  The tasks are
+    * constructed from *first: use a std::move_iterator for move only
+    * callables.
+    */
+   template< typename INPUT_IT >
+   void post_bulk( INPUT_IT first, INPUT_IT const last ) {
+      pool_.push_bulk( first, last );
+   }
+
+   // Runs all posted tasks and joins the workers.
+   void drain() {
+      if( drained_ ) {
+         return;
+      }
+      drained_ = true;
+      pool_.terminate();
+      for( std::thread & t : workers_ ) {
+         t.join();
+      }
+   }
+
+   // The statistics of the pool (see object_pool::policies::stats).
+   object_pool::stats_snapshot snapshot() const {
+      return pool_.snapshot();
+   }
+
+private:
+   // Runs until the pool is terminated and drained.
+   void work() {
+      std::vector< task_type > batch;
+      batch.reserve( POP_BATCH );
+      try {
+         while( true ) {
+            pool_.pop_bulk( std::back_inserter( batch ), POP_BATCH );
+            for( task_type & t : batch ) {
+               t();
+            }
+            batch.clear();
+         }
+      } catch( ptl::object_pool::terminate_except const & ) {
+      }
+   }
+
+   POOL pool_;
+   bool drained_;
+   std::vector< std::thread > workers_;
+};
+
+}}
+
+#endif
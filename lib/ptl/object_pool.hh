@@ -1,10 +1,27 @@
 #ifndef PTL_OBJECT_POOL_HH
 #define PTL_OBJECT_POOL_HH
 
+#include <algorithm>
+#include <array>
 #include <cstdlib>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <atomic>
+#include <chrono>
+#include <limits>
+#include <memory>
 #include <mutex>
 #include <condition_variable>
+#include <deque>
+#include <functional>
 #include <queue>
+#include <stdexcept>
+#include <thread>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
 /*
  * Object Pool
@@ -13,10 +30,17 @@
  * wich has to be worked on by some instance.
  * The following behaviour is configurable with the help of the
  * different policies:
- * o threading::multi / threading::single
- * o notify::all / notify::none
+ * o threading::multi / threading::lock_free / threading::single
+ * o notify::all / notify::one / notify::none
+ *   / notify::spin / notify::spin_yield / notify::spin_then_park
  * o termination::terminatable / termination::run_forever
+ * o container::queue / container::mpmc_ring / container::spsc_ring
+ *   / container::ws_deque / container::segmented
+ *   / container::priority
+ *   / container::bucket_priority
+ *   / container::coalescing
  * o size_handling::constant / size_handling::unlimited
+ * o stats::none / stats::counting
  * Please note, that the details of the threading constructs of
  * implementation of the different policies must match, e.g. all
  * must use e.g. C++ std::thread / std::mutex / std::condition_variable.
@@ -31,29 +55,243 @@ public:
    }
 };
 
+enum class pop_status {
+   ok,
+   // The pool is terminated and drained.
+   closed,
+   // try_pop(): the pool is empty.
+   empty,
+   // pop_for() / pop_until(): the deadline was reached.
+   timeout
+};
+
+/*
+ * Result of the non throwing pop functions: either holds the popped
+ * object (status ok) or no object and the reason why.
+ */
+template< typename OBJ_TYPE >
+class pop_result {
+public:
+   explicit pop_result( pop_status const status )
+      : status_( status ) {
+   }
+
+   explicit pop_result( OBJ_TYPE && t )
+      : status_( pop_status::ok ) {
+      new( &storage_ ) OBJ_TYPE( std::move( t ) );
+   }
+
+   pop_result( pop_result && other )
+      : status_( other.status_ ) {
+      if( status_ == pop_status::ok ) {
+         new( &storage_ ) OBJ_TYPE( std::move( *other ) );
+      }
+   }
+
+   ~pop_result() {
+      if( status_ == pop_status::ok ) {
+         object()->~OBJ_TYPE();
+      }
+   }
+
+   pop_result( pop_result const & ) = delete;
+   pop_result & operator=( pop_result const & ) = delete;
+   pop_result & operator=( pop_result && ) = delete;
+
+   pop_status status() const {
+      return status_;
+   }
+
+   explicit operator bool() const {
+      return status_ == pop_status::ok;
+   }
+
+   OBJ_TYPE & operator*() {
+      if( status_ != pop_status::ok ) {
+         // Programming bug: there is no object.
+         abort();
+      }
+      return *object();
+   }
+
+   OBJ_TYPE * operator->() {
+      return &**this;
+   }
+
+private:
+   OBJ_TYPE * object() {
+      return reinterpret_cast< OBJ_TYPE * >( &storage_ );
+   }
+
+   pop_status const status_;
+   typename std::aligned_storage<
+      sizeof( OBJ_TYPE ), alignof( OBJ_TYPE ) >::type storage_;
+};
+
+/*
+ * Statistics of a pool (see policies::stats).  All times are summed
+ * up over all threads / objects.
+ */
+class stats_snapshot {
+public:
+   stats_snapshot()
+      : pushes( 0 ), pops( 0 ),
+        producer_waits( 0 ), producer_wait_time( 0 ),
+        consumer_waits( 0 ), consumer_wait_time( 0 ),
+        contended_locks( 0 ), high_water_mark( 0 ),
+        dwell_time( 0 ) {
+   }
+
+   // Average time an object spends in the pool.
+   std::chrono::nanoseconds mean_dwell_time() const {
+      return pushes == 0 ? std::chrono::nanoseconds( 0 )
+         : dwell_time / static_cast< long >( pushes );
+   }
+
+   std::uint64_t pushes;
+   std::uint64_t pops;
+   // Number of times a producer had to wait for a free slot and
+   // the time it waited.
+   std::uint64_t producer_waits;
+   std::chrono::nanoseconds producer_wait_time;
+   // Number of times a consumer had to wait for an object and the
+   // time it waited.
+   std::uint64_t consumer_waits;
+   std::chrono::nanoseconds consumer_wait_time;
+   // Number of times the (data path) lock was already held by
+   // another thread.
+   std::uint64_t contended_locks;
+   // Maximum number of objects in the pool.
+   std::size_t high_water_mark;
+   // Time all pushed objects spent in the pool - for objects which
+   // are still in the pool until now.
+   std::chrono::nanoseconds dwell_time;
+};
+
+namespace detail {
+
+// Used to separate data which is written by different threads
+// into different cache lines.
+std::size_t const cache_line_size( 64 );
+
+// A small number which identifies the calling thread: the threads
+// are numbered in the order they call this the first time.
+inline std::size_t thread_index() {
+   static std::atomic< std::size_t > next( 0 );
+   static thread_local std::size_t const index(
+      next.fetch_add( 1, std::memory_order_relaxed ) );
+   return index;
+}
+
+// The smallest power of two which is not less than n.
+inline std::size_t round_up_pow2( std::size_t const n ) {
+   std::size_t r( 1 );
+   while( r < n ) {
+      r <<= 1;
+   }
+   return r;
+}
+
+// The index of the highest set bit; v must not be 0.
+inline std::size_t highest_bit( std::uint64_t const v ) {
+#if defined( __GNUC__ )
+   return 63 - static_cast< std::size_t >( __builtin_clzll( v ) );
+#else
+   std::size_t r( 0 );
+   for( std::uint64_t x( v ); x > 1; x >>= 1 ) {
+      ++r;
+   }
+   return r;
+#endif
+}
+
+// Tells the CPU that this is a spin loop.
+inline void cpu_relax() {
+#if defined( __i386__ ) || defined( __x86_64__ )
+   __builtin_ia32_pause();
+#elif defined( __aarch64__ ) || defined( __arm__ )
+   __asm__ __volatile__( "yield" );
+#endif
+}
+
+// If CONTAINER only provides try_push() / try_pop() (e.g. a lock
+// free ring) instead of push() / pop().
+template< typename CONTAINER, typename OBJ_TYPE >
+class has_try_pop {
+   template< typename C >
+   static auto check( int ) -> decltype(
+      std::declval< C & >().try_pop( std::declval< OBJ_TYPE & >() ),
+      std::true_type() );
+
+   template< typename C >
+   static std::false_type check( ... );
+
+public:
+   static bool const value = decltype( check< CONTAINER >( 0 ) )::value;
+};
+
+}
+
 namespace policies {
 
 /*
- * o threading::multi / threading::single:
+ * o threading::multi / threading::lock_free / threading::single:
  *   The multi-threaded version does a correct locking everywhere
- *   where it's needed.  The single threaded version does the
- *   apropriate locking for a single thread, which is it does nothing.
+ *   where it's needed.  The lock free version leaves the
+ *   synchronization of the data path to the container (which must
+ *   be a lock free one like container::mpmc_ring); a mutex is only
+ *   used for the life cycle (start / terminate) and to park waiting
+ *   threads.  The single threaded version does the apropriate
+ *   locking for a single thread, which is it does nothing.
+ *
+ *   'locks_container' tells the pool if it must serialize the
+ *   container access with the lock (std::true_type) or if the
+ *   container does this on its own (std::false_type).  Containers
+ *   which only provide try_push() / try_pop() are always used
+ *   through them: so threading::single also works with e.g. the
+ *   lock free rings.
+ *   'lifecycle_lock' is the lock which is used by the pool for
+ *   start(), terminate() and register_terminator().
+ *   The (data path) lock can be temporarily released with unlock()
+ *   and relock() - e.g. by a notify policy which spins.
+ *   contended() tells if the lock had to wait for another thread.
  */
 
 namespace threading {
 
 class multi {
 public:
+   using locks_container = std::true_type;
+
    class lock {
    public:
       lock( multi & m )
-      : lock_( m.get_mutex() ) {}
+      : lock_( m.get_mutex(), std::try_to_lock ),
+        contended_( not lock_.owns_lock() ) {
+         if( contended_ ) {
+            lock_.lock();
+         }
+      }
+
+      // True when the mutex was held by another thread.
+      bool contended() const {
+         return contended_;
+      }
 
       std::unique_lock< std::mutex > & get_lock() {
          return lock_;
       }
+
+      void unlock() {
+         lock_.unlock();
+      }
+
+      void relock() {
+         lock_.lock();
+      }
    private:
       std::unique_lock< std::mutex > lock_;
+      bool const contended_;
    };
 
 private:
@@ -64,18 +302,79 @@ private:
    std::mutex mutex_;
 
    friend class lock;
+
+public:
+   using lifecycle_lock = lock;
+};
+
+class lock_free {
+public:
+   using locks_container = std::false_type;
+
+   // The data path does not lock at all.
+   class lock {
+   public:
+      lock( lock_free & ) {}
+
+      bool contended() const { return false; }
+      void unlock() {}
+      void relock() {}
+   };
+
+   class lifecycle_lock {
+   public:
+      lifecycle_lock( lock_free & m )
+      : lock_( m.mutex_ ) {}
+
+      std::unique_lock< std::mutex > & get_lock() {
+         return lock_;
+      }
+   private:
+      std::unique_lock< std::mutex > lock_;
+   };
+
+private:
+   std::mutex mutex_;
+
+   friend class lifecycle_lock;
 };
 
-// XXX To implement
-// XXX To test
+// Everything is done by one thread: there is nothing to lock.
 class single {
+public:
+   using locks_container = std::true_type;
+
+   class lock {
+   public:
+      lock( single & ) {}
+
+      bool contended() const { return false; }
+      void unlock() {}
+      void relock() {}
+   };
+
+   using lifecycle_lock = lock;
 };
 
 }
 
 /*
- * o notify::all / notify::none:
+ * o notify::all / notify::one / notify::none:
  * Send out notifications (or not) when the pool is full or empty.
+ * notify() is called when one object (or slot) is available,
+ * notify( n ) when n are available and notify_all() when all
+ * waiters must recheck their state (e.g. termination).
+ * notify::all always wakes up all waiters; notify::one counts
+ * the waiters and only wakes up one waiter per available object
+ * and none at all if nobody waits.  As a waiter which is woken
+ * up and whose predicate is still false does not pass on the
+ * notification, all waiters on a notify::one must wait for the
+ * same condition (e.g. pop_bulk() with min_n > 1 should not be
+ * mixed with pop()).
+ * wait( lock, pred ) returns when the predicate is true; the
+ * predicate is always evaluated with the (data path) lock held.
+ * wait_until( lock, pred, deadline ) additionally returns when the
+ * deadline is reached; it returns the last value of the predicate.
  */
 
 namespace notify {
@@ -87,134 +386,1548 @@ public:
       cv_not_prop_.notify_all();
    }
 
+   void notify( std::size_t const ) {
+      cv_not_prop_.notify_all();
+   }
+
+   void notify_all() {
+      cv_not_prop_.notify_all();
+   }
+
    void wait( typename POLICIY_THREADING::lock & lock ) {
       cv_not_prop_.wait( lock.get_lock() );
    }
 
+   template< typename PRED >
+   void wait( typename POLICIY_THREADING::lock & lock, PRED pred ) {
+      while( not pred() ) {
+         cv_not_prop_.wait( lock.get_lock() );
+      }
+   }
+
+   template< typename PRED, typename CLOCK, typename DURATION >
+   bool wait_until(
+      typename POLICIY_THREADING::lock & lock, PRED pred,
+      std::chrono::time_point< CLOCK, DURATION > const & deadline ) {
+      return cv_not_prop_.wait_until( lock.get_lock(), deadline, pred );
+   }
+
 private:
    std::condition_variable cv_not_prop_;
 };
 
-// XXX To implement
-// XXX To test
-class none {
+/*
+ * For lock free pools the state changes happen without any lock.
+ * Therefore the waiting threads are counted: the notifying
+ * thread only takes the mutex when there is somebody waiting.
+ * The sequentially consistent fences on both sides ensure that
+ * either the waiter sees the changed state or the notifier sees
+ * the waiter.
+ */
+template<>
+class all< threading::lock_free > {
+public:
+   all()
+      : waiters_( 0 ) {
+   }
+
+   void notify() {
+      notify_all();
+   }
+
+   void notify( std::size_t const ) {
+      notify_all();
+   }
+
+   void notify_all() {
+      std::atomic_thread_fence( std::memory_order_seq_cst );
+      if( waiters_.load( std::memory_order_relaxed ) != 0 ) {
+         std::lock_guard< std::mutex > guard( mutex_ );
+         cv_not_prop_.notify_all();
+      }
+   }
+
+   template< typename PRED >
+   void wait( threading::lock_free::lock &, PRED pred ) {
+      std::unique_lock< std::mutex > guard( mutex_ );
+      waiters_.fetch_add( 1, std::memory_order_relaxed );
+      std::atomic_thread_fence( std::memory_order_seq_cst );
+      while( not pred() ) {
+         cv_not_prop_.wait( guard );
+      }
+      waiters_.fetch_sub( 1, std::memory_order_relaxed );
+   }
+
+   template< typename PRED, typename CLOCK, typename DURATION >
+   bool wait_until(
+      threading::lock_free::lock &, PRED pred,
+      std::chrono::time_point< CLOCK, DURATION > const & deadline ) {
+      std::unique_lock< std::mutex > guard( mutex_ );
+      waiters_.fetch_add( 1, std::memory_order_relaxed );
+      std::atomic_thread_fence( std::memory_order_seq_cst );
+      bool const rval( cv_not_prop_.wait_until( guard, deadline, pred ) );
+      waiters_.fetch_sub( 1, std::memory_order_relaxed );
+      return rval;
+   }
+
+protected:
+   std::atomic< long > waiters_;
+   std::mutex mutex_;
+   std::condition_variable cv_not_prop_;
 };
 
-}
+/*
+ * The waiters are counted with the help of the lock: a waiter
+ * increments the counter with the lock held before it waits.  So
+ * the notifying thread (which changed the state with the lock held
+ * before) sees the waiter - even if it calls notify() after
+ * releasing the lock.
+ */
+template< typename POLICIY_THREADING >
+class one {
+public:
+   one()
+      : waiters_( 0 ) {
+   }
+
+   void notify() {
+      if( waiters_.load( std::memory_order_relaxed ) != 0 ) {
+         cv_not_prop_.notify_one();
+      }
+   }
+
+   void notify( std::size_t const n ) {
+      long const waiters( waiters_.load( std::memory_order_relaxed ) );
+      if( waiters == 0 ) {
+         return;
+      }
+      if( n >= static_cast< std::size_t >( waiters ) ) {
+         cv_not_prop_.notify_all();
+         return;
+      }
+      for( std::size_t i( 0 ); i < n; ++i ) {
+         cv_not_prop_.notify_one();
+      }
+   }
+
+   void notify_all() {
+      if( waiters_.load( std::memory_order_relaxed ) != 0 ) {
+         cv_not_prop_.notify_all();
+      }
+   }
+
+   template< typename PRED >
+   void wait( typename POLICIY_THREADING::lock & lock, PRED pred ) {
+      while( not pred() ) {
+         waiters_.fetch_add( 1, std::memory_order_relaxed );
+         cv_not_prop_.wait( lock.get_lock() );
+         waiters_.fetch_sub( 1, std::memory_order_relaxed );
+      }
+   }
+
+   template< typename PRED, typename CLOCK, typename DURATION >
+   bool wait_until(
+      typename POLICIY_THREADING::lock & lock, PRED pred,
+      std::chrono::time_point< CLOCK, DURATION > const & deadline ) {
+      while( not pred() ) {
+         waiters_.fetch_add( 1, std::memory_order_relaxed );
+         std::cv_status const status(
+            cv_not_prop_.wait_until( lock.get_lock(), deadline ) );
+         waiters_.fetch_sub( 1, std::memory_order_relaxed );
+         if( status == std::cv_status::timeout ) {
+            return pred();
+         }
+      }
+      return true;
+   }
+
+private:
+   std::atomic< long > waiters_;
+   std::condition_variable cv_not_prop_;
+};
+
+template<>
+class one< threading::lock_free >
+   : public all< threading::lock_free > {
+public:
+   void notify() {
+      notify( 1 );
+   }
+
+   void notify( std::size_t const n ) {
+      std::atomic_thread_fence( std::memory_order_seq_cst );
+      long const waiters( waiters_.load( std::memory_order_relaxed ) );
+      if( waiters == 0 ) {
+         return;
+      }
+      std::lock_guard< std::mutex > guard( mutex_ );
+      if( n >= static_cast< std::size_t >( waiters ) ) {
+         cv_not_prop_.notify_all();
+         return;
+      }
+      for( std::size_t i( 0 ); i < n; ++i ) {
+         cv_not_prop_.notify_one();
+      }
+   }
+};
 
 /*
- * o termination::terminatable / termination::run_forever:
- *   Configures if the pool propagates termination requests
- *   or not.
+ * Wait strategies: instead of parking the thread in the kernel
+ * (like notify::all / notify::one), these trade CPU for latency:
+ * o spin: busy spins (with the CPU pause instruction) until it is
+ *   notified.
+ * o spin_yield: spins a bounded number of times and then yields
+ *   the CPU between checks.
+ * o spin_then_park: adaptive: spins up to a learned budget (about
+ *   twice the typical wait) and then parks the thread.
+ * All are based on an epoch counter which is incremented by each
+ * notification: a waiter reads the epoch, checks its predicate,
+ * releases the lock and waits for a change of the epoch.
+ * The number of spins can be configured with an alias template,
+ * e.g.
+ *   template< typename T >
+ *   using my_yield = notify::basic_spin_yield< T, 1000 >;
  */
-namespace termination {
+namespace wait_strategy {
 
-template< typename POLICIY_THREADING >
-class terminatable {
+class no_deadline {
 public:
-   terminatable()
-      : started_( false ),
-        terminate_cnt_( 0 ) {
+   bool expired() const {
+      return false;
    }
+};
 
-   bool should_terminate() const {
-      return started_ == true and terminate_cnt_ == 0;
+template< typename CLOCK, typename DURATION >
+class deadline {
+public:
+   deadline( std::chrono::time_point< CLOCK, DURATION > const & tp )
+      : tp_( tp ) {
    }
 
-   void start() {
-      if( started_ ) {
-         // This should never happen: programing bug:
-         // Start was already called.
-         abort();
+   bool expired() const {
+      return CLOCK::now() >= tp_;
+   }
+
+   std::chrono::time_point< CLOCK, DURATION > const & time_point() const {
+      return tp_;
+   }
+
+private:
+   std::chrono::time_point< CLOCK, DURATION > const tp_;
+};
+
+// Checking the clock is expensive: only do it every n spins.
+unsigned long const deadline_check_interval( 128 );
+
+class busy_spin {
+public:
+   void notify() {}
+
+   template< typename DEADLINE >
+   bool wait_for_change( std::atomic< unsigned long > const & epoch,
+                         unsigned long const e,
+                         DEADLINE const & deadline ) {
+      for( unsigned long i( 1 );
+           epoch.load( std::memory_order_acquire ) == e; ++i ) {
+         if( i % deadline_check_interval == 0 and deadline.expired() ) {
+            return false;
+         }
+         detail::cpu_relax();
       }
-      started_ = true;
-      if( terminate_cnt_ == 0 ) {
-         // This should never happen - programming bug:
-         // There was no 'register_terminator' called.
-         abort();
+      return true;
+   }
+};
+
+template< unsigned long SPINS >
+class spin_yield {
+public:
+   void notify() {}
+
+   template< typename DEADLINE >
+   bool wait_for_change( std::atomic< unsigned long > const & epoch,
+                         unsigned long const e,
+                         DEADLINE const & deadline ) {
+      for( unsigned long i( 1 );
+           epoch.load( std::memory_order_acquire ) == e; ++i ) {
+         if( i < SPINS ) {
+            detail::cpu_relax();
+            continue;
+         }
+         if( deadline.expired() ) {
+            return false;
+         }
+         std::this_thread::yield();
       }
-      cv_wait_for_start_.notify_all();
+      return true;
+   }
+};
+
+template< unsigned long MIN_SPINS, unsigned long MAX_SPINS >
+class spin_then_park {
+public:
+   spin_then_park()
+      : budget_( MIN_SPINS ),
+        waiters_( 0 ) {
    }
 
-   void terminate( typename POLICIY_THREADING::lock & lock ) {
-      // Ensure that this thread was really started.
-      while( not started_ ) {
-         cv_wait_for_start_.wait( lock.get_lock() );
+   // Called after the epoch was incremented.
+   void notify() {
+      std::atomic_thread_fence( std::memory_order_seq_cst );
+      if( waiters_.load( std::memory_order_relaxed ) != 0 ) {
+         std::lock_guard< std::mutex > guard( mutex_ );
+         cv_.notify_all();
       }
-      --terminate_cnt_;
-      if( terminate_cnt_ < 0 ) {
-         // Programming bug:
-         // terminate() was called to often for this pool.
-         abort();
+   }
+
+   template< typename DEADLINE >
+   bool wait_for_change( std::atomic< unsigned long > const & epoch,
+                         unsigned long const e,
+                         DEADLINE const & deadline ) {
+      unsigned long const budget( budget_.load( std::memory_order_relaxed ) );
+      for( unsigned long i( 0 ); i < budget; ++i ) {
+         if( epoch.load( std::memory_order_acquire ) != e ) {
+            learn( ( budget * 7 + i * 2 ) / 8 );
+            return true;
+         }
+         detail::cpu_relax();
       }
-      if( terminate_cnt_ == 0) {
-         cv_wait_for_termination_.notify_all();
+      // Spinning did not help: use less the next time.
+      learn( budget / 2 );
+      return park( epoch, e, deadline );
+   }
+
+private:
+   void learn( unsigned long const budget ) {
+      budget_.store( budget < MIN_SPINS ? MIN_SPINS
+                     : budget > MAX_SPINS ? MAX_SPINS : budget,
+                     std::memory_order_relaxed );
+   }
+
+   template< typename DEADLINE >
+   bool park( std::atomic< unsigned long > const & epoch,
+              unsigned long const e, DEADLINE const & deadline ) {
+      std::unique_lock< std::mutex > guard( mutex_ );
+      waiters_.fetch_add( 1, std::memory_order_relaxed );
+      std::atomic_thread_fence( std::memory_order_seq_cst );
+      bool rval( true );
+      while( epoch.load( std::memory_order_acquire ) == e ) {
+         if( not park_wait( guard, deadline ) ) {
+            rval = epoch.load( std::memory_order_acquire ) != e;
+            break;
+         }
+      }
+      waiters_.fetch_sub( 1, std::memory_order_relaxed );
+      return rval;
+   }
+
+   bool park_wait( std::unique_lock< std::mutex > & guard,
+                   no_deadline const & ) {
+      cv_.wait( guard );
+      return true;
+   }
+
+   template< typename CLOCK, typename DURATION >
+   bool park_wait( std::unique_lock< std::mutex > & guard,
+                   deadline< CLOCK, DURATION > const & deadline ) {
+      return cv_.wait_until( guard, deadline.time_point() )
+         == std::cv_status::no_timeout;
+   }
+
+   std::atomic< unsigned long > budget_;
+   std::atomic< long > waiters_;
+   std::mutex mutex_;
+   std::condition_variable cv_;
+};
+
+}
+
+template< typename POLICIY_THREADING, typename WAIT_STRATEGY >
+class epoch_wait {
+public:
+   epoch_wait()
+      : epoch_( 0 ) {
+   }
+
+   void notify() {
+      epoch_.fetch_add( 1, std::memory_order_release );
+      strategy_.notify();
+   }
+
+   void notify( std::size_t const ) {
+      notify();
+   }
+
+   void notify_all() {
+      notify();
+   }
+
+   template< typename PRED >
+   void wait( typename POLICIY_THREADING::lock & lock, PRED pred ) {
+      wait_( lock, pred, wait_strategy::no_deadline() );
+   }
+
+   template< typename PRED, typename CLOCK, typename DURATION >
+   bool wait_until(
+      typename POLICIY_THREADING::lock & lock, PRED pred,
+      std::chrono::time_point< CLOCK, DURATION > const & deadline ) {
+      return wait_(
+         lock, pred,
+         wait_strategy::deadline< CLOCK, DURATION >( deadline ) );
+   }
+
+private:
+   template< typename PRED, typename DEADLINE >
+   bool wait_( typename POLICIY_THREADING::lock & lock, PRED pred,
+               DEADLINE const & deadline ) {
+      while( true ) {
+         // The epoch must be read before the predicate is checked:
+         // so each state change after the check is seen.
+         unsigned long const e( epoch_.load( std::memory_order_acquire ) );
+         if( pred() ) {
+            return true;
+         }
+         lock.unlock();
+         bool const changed(
+            strategy_.wait_for_change( epoch_, e, deadline ) );
+         lock.relock();
+         if( not changed ) {
+            return pred();
+         }
+      }
+   }
+
+   std::atomic< unsigned long > epoch_;
+   char pad_[ detail::cache_line_size ];
+   WAIT_STRATEGY strategy_;
+};
+
+template< typename POLICIY_THREADING >
+using spin = epoch_wait< POLICIY_THREADING, wait_strategy::busy_spin >;
+
+template< typename POLICIY_THREADING, unsigned long SPINS >
+using basic_spin_yield = epoch_wait<
+   POLICIY_THREADING, wait_strategy::spin_yield< SPINS > >;
+
+template< typename POLICIY_THREADING >
+using spin_yield = basic_spin_yield< POLICIY_THREADING, 100 >;
+
+template< typename POLICIY_THREADING,
+          unsigned long MIN_SPINS, unsigned long MAX_SPINS >
+using basic_spin_then_park = epoch_wait<
+   POLICIY_THREADING,
+   wait_strategy::spin_then_park< MIN_SPINS, MAX_SPINS > >;
+
+template< typename POLICIY_THREADING >
+using spin_then_park = basic_spin_then_park< POLICIY_THREADING, 16, 16384 >;
+
+/*
+ * Never waits and never notifies: for pools which are only used by
+ * one thread (threading::single) nobody else can change the state
+ * while waiting.  So a wait() for a predicate which is false is a
+ * programming bug (it would wait forever) and wait_until() returns
+ * immediately.
+ */
+template< typename POLICIY_THREADING >
+class none {
+public:
+   void notify() {}
+   void notify( std::size_t const ) {}
+   void notify_all() {}
+
+   template< typename PRED >
+   void wait( typename POLICIY_THREADING::lock &, PRED pred ) {
+      if( not pred() ) {
+         // Programming bug: this would wait forever.
+         abort();
+      }
+   }
+
+   template< typename PRED, typename CLOCK, typename DURATION >
+   bool wait_until(
+      typename POLICIY_THREADING::lock &, PRED pred,
+      std::chrono::time_point< CLOCK, DURATION > const & ) {
+      return pred();
+   }
+};
+
+}
+
+/*
+ * o termination::terminatable / termination::run_forever:
+ *   Configures if the pool propagates termination requests
+ *   or not.
+ */
+namespace termination {
+
+template< typename POLICIY_THREADING >
+class terminatable {
+public:
+   terminatable()
+      : started_( false ),
+        terminate_cnt_( 0 ) {
+   }
+
+   // The state is atomic, so that lock free pools can call this
+   // without holding any lock.
+   bool should_terminate() const {
+      return started_ == true and terminate_cnt_ == 0;
+   }
+
+   void start() {
+      if( started_ ) {
+         // This should never happen: programing bug:
+         // Start was already called.
+         abort();
+      }
+      started_ = true;
+      if( terminate_cnt_ == 0 ) {
+         // This should never happen - programming bug:
+         // There was no 'register_terminator' called.
+         abort();
+      }
+      cv_wait_for_start_.notify_all();
+   }
+
+   void terminate( typename POLICIY_THREADING::lifecycle_lock & lock ) {
+      // Ensure that this thread was really started.
+      while( not started_ ) {
+         cv_wait_for_start_.wait( lock.get_lock() );
+      }
+      --terminate_cnt_;
+      if( terminate_cnt_ < 0 ) {
+         // Programming bug:
+         // terminate() was called to often for this pool.
+         abort();
+      }
+      if( terminate_cnt_ == 0) {
+         cv_wait_for_termination_.notify_all();
+      }
+   }
+
+   void register_terminator() {
+      if( started_ ) {
+         // This should never happen: programing bug:
+         // Start was already called - before finishing to register
+         // all terminators.
+         abort();
+      }
+      ++terminate_cnt_;
+   }
+
+private:
+   std::atomic< bool > started_;
+   std::atomic< long > terminate_cnt_;
+
+   std::condition_variable cv_wait_for_start_;
+   std::condition_variable cv_wait_for_termination_;
+};
+
+/*
+ * The pool is never terminated: there is no state at all.  As there
+ * is no terminate(), a call of pool::terminate() does not compile.
+ */
+template< typename POLICIY_THREADING >
+class run_forever {
+public:
+   bool should_terminate() const {
+      return false;
+   }
+
+   void start() {}
+   void register_terminator() {}
+};
+
+}
+
+/*
+ * This is an abstraction of the underlaying container.
+ * Each container is constructed with the maximum size of the
+ * size handling policy.
+ * o queue: std::queue based; must be used together with a
+ *   threading policy which locks the container.
+ * o mpmc_ring: bounded lock free multi producer / multi consumer
+ *   ring; must be used together with threading::lock_free (or
+ *   threading::single).
+ * o spsc_ring: bounded wait free single producer / single consumer
+ *   ring; must be used together with threading::lock_free and
+ *   exactly one pushing and one popping thread (or with
+ *   threading::single).
+ * o ws_deque: lock free work stealing deque; must be used together
+ *   with threading::lock_free.  Only the registered owner thread
+ *   pushes; it pops the newest objects (LIFO) while all other
+ *   threads steal the oldest ones (FIFO).
+ * o segmented: FIFO in linked fixed size segments which never
+ *   reallocates or copies objects when it grows; must be used
+ *   together with a threading policy which locks the container.
+ * o priority / bucket_priority: the object with the highest
+ *   priority is popped first; must be used together with a
+ *   threading policy which locks the container.  priority is a
+ *   d-ary heap, bucket_priority has one FIFO per priority level
+ *   for a small range of integer priorities.
+ * o coalescing: FIFO where an object replaces the pending object
+ *   with the same key in place (e.g. the latest state of an entity
+ *   is sufficient); must be used together with a threading policy
+ *   which locks the container.
+ * Locked containers provide push() / emplace() / pop(); lock free
+ * containers provide try_push() / try_emplace() / try_pop() which
+ * fail when the container is full / empty.  In both cases the
+ * objects are moved out of the container.  A locked container's
+ * emplace() may return a bool: false means that no object was added
+ * (e.g. coalescing replaced a pending one).
+ */
+namespace container {
+
+template< typename OBJ_TYPE >
+class queue {
+public:
+   queue( std::size_t const /* max_size */ ) {
+   }
+
+   void push( OBJ_TYPE const & t ) {
+      queue_.push( t );
+   }
+
+   void push( OBJ_TYPE && t ) {
+      queue_.push( std::move( t ) );
+   }
+
+   template< typename ... ARGS >
+   void emplace( ARGS && ... args ) {
+      queue_.emplace( std::forward< ARGS >( args ) ... );
+   }
+
+   std::size_t size() const {
+      return queue_.size();
+   }
+
+   OBJ_TYPE pop() {
+      OBJ_TYPE rval( std::move( queue_.front() ) );
+      queue_.pop();
+      return rval;
+   }
+
+   bool empty() const {
+      return queue_.empty();
+   }
+
+private:
+   std::queue< OBJ_TYPE > queue_;
+};
+
+/*
+ * Bounded lock free multi producer / multi consumer ring.
+ * Each slot carries a sequence number which tells if the slot
+ * can be written (seq == pos) or read (seq == pos + 1) for the
+ * position 'pos'.  So producers and consumers only compete for
+ * the tail / head index and never for a lock.
+ * The capacity is exactly the max_size of the size handling.
+ * OBJ_TYPE must be default constructible (as try_pop() moves
+ * into an existing object).
+ */
+template< typename OBJ_TYPE >
+class mpmc_ring {
+public:
+   mpmc_ring( std::size_t const max_size )
+      : capacity_( max_size ),
+        slots_( new slot[ max_size ] ),
+        head_( 0 ),
+        tail_( 0 ) {
+      if( capacity_ == 0 ) {
+         // Programming bug: a ring needs at least one slot.
+         abort();
+      }
+      for( std::size_t i( 0 ); i < capacity_; ++i ) {
+         slots_[ i ].seq.store( i, std::memory_order_relaxed );
+      }
+   }
+
+   ~mpmc_ring() {
+      OBJ_TYPE t;
+      while( try_pop( t ) ) {}
+   }
+
+   mpmc_ring( mpmc_ring const & ) = delete;
+   mpmc_ring & operator=( mpmc_ring const & ) = delete;
+
+   bool try_push( OBJ_TYPE const & t ) {
+      return try_emplace( t );
+   }
+
+   bool try_push( OBJ_TYPE && t ) {
+      return try_emplace( std::move( t ) );
+   }
+
+   // The arguments are only used when there is a free slot.
+   template< typename ... ARGS >
+   bool try_emplace( ARGS && ... args ) {
+      std::size_t pos( tail_.load( std::memory_order_relaxed ) );
+      while( true ) {
+         slot & s( slots_[ pos % capacity_ ] );
+         std::size_t const seq( s.seq.load( std::memory_order_acquire ) );
+         std::ptrdiff_t const diff(
+            static_cast< std::ptrdiff_t >( seq - pos ) );
+         if( diff == 0 ) {
+            if( tail_.compare_exchange_weak(
+                   pos, pos + 1, std::memory_order_relaxed ) ) {
+               new( &s.storage ) OBJ_TYPE( std::forward< ARGS >( args ) ... );
+               s.seq.store( pos + 1, std::memory_order_release );
+               return true;
+            }
+         } else if( diff < 0 ) {
+            // The slot was not yet consumed: full.
+            return false;
+         } else {
+            pos = tail_.load( std::memory_order_relaxed );
+         }
+      }
+   }
+
+   bool try_pop( OBJ_TYPE & t ) {
+      std::size_t pos( head_.load( std::memory_order_relaxed ) );
+      while( true ) {
+         slot & s( slots_[ pos % capacity_ ] );
+         std::size_t const seq( s.seq.load( std::memory_order_acquire ) );
+         std::ptrdiff_t const diff(
+            static_cast< std::ptrdiff_t >( seq - ( pos + 1 ) ) );
+         if( diff == 0 ) {
+            if( head_.compare_exchange_weak(
+                   pos, pos + 1, std::memory_order_relaxed ) ) {
+               OBJ_TYPE * const p( s.object() );
+               t = std::move( *p );
+               p->~OBJ_TYPE();
+               s.seq.store( pos + capacity_, std::memory_order_release );
+               return true;
+            }
+         } else if( diff < 0 ) {
+            // The slot was not yet written: empty.
+            return false;
+         } else {
+            pos = head_.load( std::memory_order_relaxed );
+         }
+      }
+   }
+
+   // Only a snapshot when used concurrently.
+   std::size_t size() const {
+      std::size_t const head( head_.load( std::memory_order_acquire ) );
+      std::size_t const tail( tail_.load( std::memory_order_acquire ) );
+      return tail > head ? tail - head : 0;
+   }
+
+   bool empty() const {
+      return size() == 0;
+   }
+
+private:
+   class slot {
+   public:
+      OBJ_TYPE * object() {
+         return reinterpret_cast< OBJ_TYPE * >( &storage );
+      }
+
+      std::atomic< std::size_t > seq;
+      typename std::aligned_storage<
+         sizeof( OBJ_TYPE ), alignof( OBJ_TYPE ) >::type storage;
+   };
+
+   std::size_t const capacity_;
+   std::unique_ptr< slot[] > const slots_;
+
+   char pad_0_[ detail::cache_line_size ];
+   std::atomic< std::size_t > head_;
+   char pad_1_[ detail::cache_line_size ];
+   std::atomic< std::size_t > tail_;
+   char pad_2_[ detail::cache_line_size ];
+};
+
+/*
+ * Bounded wait free single producer / single consumer ring.
+ * The storage is preallocated with a power of two number of slots
+ * (so that the index is a simple mask) - but never more than
+ * max_size elements are stored.
+ * The producer owns the tail, the consumer the head; each side
+ * keeps a cached copy of the other side's index in its own cache
+ * line and only reloads it when the ring looks full / empty.
+ * OBJ_TYPE must be default constructible (as try_pop() moves
+ * into an existing object).
+ */
+template< typename OBJ_TYPE >
+class spsc_ring {
+public:
+   spsc_ring( std::size_t const max_size )
+      : capacity_( max_size ),
+        mask_( detail::round_up_pow2( max_size ) - 1 ),
+        slots_( new storage[ mask_ + 1 ] ),
+        head_( 0 ),
+        tail_cache_( 0 ),
+        tail_( 0 ),
+        head_cache_( 0 ) {
+      if( capacity_ == 0 ) {
+         // Programming bug: a ring needs at least one slot.
+         abort();
+      }
+   }
+
+   ~spsc_ring() {
+      OBJ_TYPE t;
+      while( try_pop( t ) ) {}
+   }
+
+   spsc_ring( spsc_ring const & ) = delete;
+   spsc_ring & operator=( spsc_ring const & ) = delete;
+
+   // Must only be called from the producer thread.
+   bool try_push( OBJ_TYPE const & t ) {
+      return try_emplace( t );
+   }
+
+   // Must only be called from the producer thread.
+   bool try_push( OBJ_TYPE && t ) {
+      return try_emplace( std::move( t ) );
+   }
+
+   // Must only be called from the producer thread.
+   // The arguments are only used when there is a free slot.
+   template< typename ... ARGS >
+   bool try_emplace( ARGS && ... args ) {
+      std::size_t const tail( tail_.load( std::memory_order_relaxed ) );
+      if( tail - head_cache_ >= capacity_ ) {
+         head_cache_ = head_.load( std::memory_order_acquire );
+         if( tail - head_cache_ >= capacity_ ) {
+            return false;
+         }
+      }
+      new( &slots_[ tail & mask_ ] ) OBJ_TYPE(
+         std::forward< ARGS >( args ) ... );
+      tail_.store( tail + 1, std::memory_order_release );
+      return true;
+   }
+
+   // Must only be called from the consumer thread.
+   bool try_pop( OBJ_TYPE & t ) {
+      std::size_t const head( head_.load( std::memory_order_relaxed ) );
+      if( head == tail_cache_ ) {
+         tail_cache_ = tail_.load( std::memory_order_acquire );
+         if( head == tail_cache_ ) {
+            return false;
+         }
+      }
+      OBJ_TYPE * const p(
+         reinterpret_cast< OBJ_TYPE * >( &slots_[ head & mask_ ] ) );
+      t = std::move( *p );
+      p->~OBJ_TYPE();
+      head_.store( head + 1, std::memory_order_release );
+      return true;
+   }
+
+   // Only a snapshot when used concurrently.
+   std::size_t size() const {
+      std::size_t const head( head_.load( std::memory_order_acquire ) );
+      std::size_t const tail( tail_.load( std::memory_order_acquire ) );
+      return tail > head ? tail - head : 0;
+   }
+
+   bool empty() const {
+      return size() == 0;
+   }
+
+private:
+   using storage = typename std::aligned_storage<
+      sizeof( OBJ_TYPE ), alignof( OBJ_TYPE ) >::type;
+
+   std::size_t const capacity_;
+   std::size_t const mask_;
+   std::unique_ptr< storage[] > const slots_;
+
+   // Consumer side
+   char pad_0_[ detail::cache_line_size ];
+   std::atomic< std::size_t > head_;
+   std::size_t tail_cache_;
+
+   // Producer side
+   char pad_1_[ detail::cache_line_size ];
+   std::atomic< std::size_t > tail_;
+   std::size_t head_cache_;
+   char pad_2_[ detail::cache_line_size ];
+};
+
+/*
+ * Lock free work stealing deque (Chase / Lev).
+ * The owner thread pushes and pops at the bottom, all other threads
+ * steal from the top - so the owner works on the most recently
+ * pushed (cache hot) objects and only competes with the thieves
+ * for the last object.
+ * The owner must call register_owner() before its first push;
+ * a push from any other thread is a programming bug.
+ * The storage starts small and is doubled by the owner when it is
+ * full - but never more than max_size elements are stored.  Old
+ * storage is kept until destruction as thieves might still read
+ * from it.
+ * The objects are stored in atomics (as a thief might read a slot
+ * which is concurrently overwritten - the read is then discarded):
+ * OBJ_TYPE must be trivially copyable, e.g. a pointer to a task.
+ */
+template< typename OBJ_TYPE >
+class ws_deque {
+public:
+   static_assert( std::is_trivially_copyable< OBJ_TYPE >::value,
+                  "ws_deque needs a trivially copyable OBJ_TYPE" );
+
+   ws_deque( std::size_t const max_size )
+      : capacity_( max_size ),
+        owner_( std::thread::id() ),
+        top_( 0 ),
+        bottom_( 0 ),
+        array_( nullptr ) {
+      if( capacity_ == 0 ) {
+         // Programming bug: a deque needs at least one slot.
+         abort();
+      }
+      arrays_.emplace_back( new array(
+         capacity_ < initial_slots
+            ? detail::round_up_pow2( capacity_ ) : initial_slots ) );
+      array_.store( arrays_.back().get(), std::memory_order_relaxed );
+   }
+
+   ws_deque( ws_deque const & ) = delete;
+   ws_deque & operator=( ws_deque const & ) = delete;
+
+   // Must be called by the owner thread before the first push.
+   void register_owner() {
+      owner_.store( std::this_thread::get_id(), std::memory_order_release );
+   }
+
+   // Must only be called from the owner thread.
+   bool try_push( OBJ_TYPE const & t ) {
+      return try_emplace( t );
+   }
+
+   // Must only be called from the owner thread.
+   // The arguments are only used when there is a free slot.
+   template< typename ... ARGS >
+   bool try_emplace( ARGS && ... args ) {
+      if( not is_owner() ) {
+         // Programming bug: only the owner pushes.
+         abort();
+      }
+      std::ptrdiff_t const b( bottom_.load( std::memory_order_relaxed ) );
+      std::ptrdiff_t const t( top_.load( std::memory_order_acquire ) );
+      std::size_t const n( static_cast< std::size_t >( b - t ) );
+      if( n >= capacity_ ) {
+         return false;
+      }
+      array * a( array_.load( std::memory_order_relaxed ) );
+      if( n >= a->size() ) {
+         a = grow( a, t, b );
+      }
+      a->put( b, OBJ_TYPE( std::forward< ARGS >( args ) ... ) );
+      std::atomic_thread_fence( std::memory_order_release );
+      bottom_.store( b + 1, std::memory_order_relaxed );
+      return true;
+   }
+
+   // The owner takes the newest object, all others steal the oldest.
+   bool try_pop( OBJ_TYPE & t ) {
+      return is_owner() ? take( t ) : steal( t );
+   }
+
+   // Only a snapshot when used concurrently.
+   std::size_t size() const {
+      std::ptrdiff_t const t( top_.load( std::memory_order_acquire ) );
+      std::ptrdiff_t const b( bottom_.load( std::memory_order_acquire ) );
+      return b > t ? static_cast< std::size_t >( b - t ) : 0;
+   }
+
+   bool empty() const {
+      return size() == 0;
+   }
+
+private:
+   static std::size_t const initial_slots = 64;
+
+   class array {
+   public:
+      array( std::size_t const size )
+         : mask_( size - 1 ),
+           slots_( new std::atomic< OBJ_TYPE >[ size ] ) {
+      }
+
+      std::size_t size() const {
+         return mask_ + 1;
+      }
+
+      OBJ_TYPE get( std::ptrdiff_t const i ) const {
+         return slots_[ static_cast< std::size_t >( i ) & mask_ ].load(
+            std::memory_order_relaxed );
+      }
+
+      void put( std::ptrdiff_t const i, OBJ_TYPE const & t ) {
+         slots_[ static_cast< std::size_t >( i ) & mask_ ].store(
+            t, std::memory_order_relaxed );
+      }
+
+   private:
+      std::size_t const mask_;
+      std::unique_ptr< std::atomic< OBJ_TYPE >[] > const slots_;
+   };
+
+   bool is_owner() const {
+      return owner_.load( std::memory_order_acquire )
+         == std::this_thread::get_id();
+   }
+
+   // Owner only: copies the live objects [t, b) into a twice as
+   // large array.
+   array * grow( array * const a, std::ptrdiff_t const t,
+                 std::ptrdiff_t const b ) {
+      arrays_.emplace_back( new array( a->size() * 2 ) );
+      array * const na( arrays_.back().get() );
+      for( std::ptrdiff_t i( t ); i < b; ++i ) {
+         na->put( i, a->get( i ) );
+      }
+      array_.store( na, std::memory_order_release );
+      return na;
+   }
+
+   bool take( OBJ_TYPE & t ) {
+      std::ptrdiff_t const b(
+         bottom_.load( std::memory_order_relaxed ) - 1 );
+      array * const a( array_.load( std::memory_order_relaxed ) );
+      bottom_.store( b, std::memory_order_relaxed );
+      std::atomic_thread_fence( std::memory_order_seq_cst );
+      std::ptrdiff_t top( top_.load( std::memory_order_relaxed ) );
+
+      if( top > b ) {
+         // Empty
+         bottom_.store( b + 1, std::memory_order_relaxed );
+         return false;
+      }
+      t = a->get( b );
+      if( top == b ) {
+         // The last object: race against the thieves.
+         bool const won( top_.compare_exchange_strong(
+            top, top + 1, std::memory_order_seq_cst,
+            std::memory_order_relaxed ) );
+         bottom_.store( b + 1, std::memory_order_relaxed );
+         return won;
+      }
+      return true;
+   }
+
+   bool steal( OBJ_TYPE & t ) {
+      while( true ) {
+         std::ptrdiff_t top( top_.load( std::memory_order_acquire ) );
+         std::atomic_thread_fence( std::memory_order_seq_cst );
+         std::ptrdiff_t const b( bottom_.load( std::memory_order_acquire ) );
+         if( top >= b ) {
+            return false;
+         }
+         array * const a( array_.load( std::memory_order_acquire ) );
+         OBJ_TYPE const rval( a->get( top ) );
+         if( top_.compare_exchange_strong(
+                top, top + 1, std::memory_order_seq_cst,
+                std::memory_order_relaxed ) ) {
+            t = rval;
+            return true;
+         }
+         // Lost the race against another thief or the owner.
+      }
+   }
+
+   std::size_t const capacity_;
+   std::atomic< std::thread::id > owner_;
+   // Owner only: all arrays ever used; the last one is the current.
+   std::vector< std::unique_ptr< array > > arrays_;
+
+   char pad_0_[ detail::cache_line_size ];
+   std::atomic< std::ptrdiff_t > top_;
+   char pad_1_[ detail::cache_line_size ];
+   std::atomic< std::ptrdiff_t > bottom_;
+   std::atomic< array * > array_;
+   char pad_2_[ detail::cache_line_size ];
+};
+
+template< typename OBJ_TYPE >
+std::size_t const ws_deque< OBJ_TYPE >::initial_slots;
+
+/*
+ * FIFO which stores the objects in a linked list of segments with
+ * SEGMENT_SIZE slots each: pushing appends to the last segment (or
+ * links a new one), popping consumes the first segment and unlinks
+ * it when it is used up.  Objects are never moved once they are
+ * pushed.
+ * Used up segments are recycled through a free list - but only as
+ * many as are currently in use and only as long as the queue holds
+ * at least LOW_WATERMARK objects; when it drains below, the free
+ * list is released.  So the memory follows the current number of
+ * objects and not the peak.
+ */
+template< typename OBJ_TYPE,
+          std::size_t SEGMENT_SIZE = 256,
+          std::size_t LOW_WATERMARK = SEGMENT_SIZE >
+class basic_segmented {
+public:
+   static_assert( SEGMENT_SIZE >= 1, "a segment needs at least one slot" );
+
+   basic_segmented( std::size_t const /* max_size */ )
+      : head_( new segment ),
+        head_pos_( 0 ),
+        size_( 0 ),
+        tail_( head_ ),
+        tail_pos_( 0 ),
+        used_( 1 ),
+        free_( nullptr ),
+        free_cnt_( 0 ) {
+   }
+
+   ~basic_segmented() {
+      while( not empty() ) {
+         pop();
+      }
+      delete head_;
+      release_free();
+   }
+
+   basic_segmented( basic_segmented const & ) = delete;
+   basic_segmented & operator=( basic_segmented const & ) = delete;
+
+   void push( OBJ_TYPE const & t ) {
+      emplace( t );
+   }
+
+   void push( OBJ_TYPE && t ) {
+      emplace( std::move( t ) );
+   }
+
+   template< typename ... ARGS >
+   void emplace( ARGS && ... args ) {
+      if( tail_pos_ == SEGMENT_SIZE ) {
+         segment * const s( alloc_segment() );
+         tail_->next = s;
+         tail_ = s;
+         tail_pos_ = 0;
+         ++used_;
+      }
+      new( tail_->object( tail_pos_ ) ) OBJ_TYPE(
+         std::forward< ARGS >( args ) ... );
+      ++tail_pos_;
+      ++size_;
+   }
+
+   std::size_t size() const {
+      return size_;
+   }
+
+   OBJ_TYPE pop() {
+      OBJ_TYPE * const p( head_->object( head_pos_ ) );
+      OBJ_TYPE rval( std::move( *p ) );
+      p->~OBJ_TYPE();
+      ++head_pos_;
+      --size_;
+
+      if( head_ == tail_ ) {
+         if( size_ == 0 ) {
+            // Start again at the beginning of the only segment.
+            head_pos_ = 0;
+            tail_pos_ = 0;
+         }
+      } else if( head_pos_ == SEGMENT_SIZE ) {
+         segment * const s( head_ );
+         head_ = head_->next;
+         head_pos_ = 0;
+         --used_;
+         free_segment( s );
+      }
+      if( size_ < LOW_WATERMARK ) {
+         release_free();
+      }
+      return rval;
+   }
+
+   bool empty() const {
+      return size_ == 0;
+   }
+
+   // The number of slots in all allocated (used and free) segments.
+   std::size_t capacity() const {
+      return ( used_ + free_cnt_ ) * SEGMENT_SIZE;
+   }
+
+private:
+   class segment {
+   public:
+      segment()
+         : next( nullptr ) {
+      }
+
+      OBJ_TYPE * object( std::size_t const pos ) {
+         return reinterpret_cast< OBJ_TYPE * >( &slots[ pos ] );
+      }
+
+      typename std::aligned_storage<
+         sizeof( OBJ_TYPE ), alignof( OBJ_TYPE ) >::type
+         slots[ SEGMENT_SIZE ];
+      segment * next;
+   };
+
+   segment * alloc_segment() {
+      if( free_ == nullptr ) {
+         return new segment;
+      }
+      segment * const s( free_ );
+      free_ = free_->next;
+      --free_cnt_;
+      s->next = nullptr;
+      return s;
+   }
+
+   void free_segment( segment * const s ) {
+      if( size_ < LOW_WATERMARK or free_cnt_ >= used_ ) {
+         delete s;
+         return;
+      }
+      s->next = free_;
+      free_ = s;
+      ++free_cnt_;
+   }
+
+   void release_free() {
+      while( free_ != nullptr ) {
+         segment * const s( free_ );
+         free_ = free_->next;
+         delete s;
+      }
+      free_cnt_ = 0;
+   }
+
+   // Objects are popped from [head_pos_, SEGMENT_SIZE) of head_ and
+   // pushed to tail_pos_ of tail_.
+   segment * head_;
+   std::size_t head_pos_;
+   std::size_t size_;
+   segment * tail_;
+   std::size_t tail_pos_;
+   // Number of segments in the list from head_ to tail_.
+   std::size_t used_;
+   segment * free_;
+   std::size_t free_cnt_;
+};
+
+template< typename OBJ_TYPE >
+using segmented = basic_segmented< OBJ_TYPE >;
+
+/*
+ * Priority queue as a d-ary heap in one contiguous vector.
+ * A larger ARITY gives a flatter heap: pop() moves fewer objects
+ * and the children which are compared are next to each other in
+ * memory (4 ints or pointers share one cache line).
+ * The object for which COMPARE says that it is not less than any
+ * other is popped first (std::less: the largest).  Objects with
+ * the same priority are not popped in FIFO order.
+ * Use basic_priority with an alias template to set the comparator
+ * or the arity, e.g.
+ *   template< typename T >
+ *   using min_priority = basic_priority< T, std::greater< T > >;
+ */
+template< typename OBJ_TYPE,
+          typename COMPARE = std::less< OBJ_TYPE >,
+          std::size_t ARITY = 4 >
+class basic_priority {
+public:
+   static_assert( ARITY >= 2, "a heap needs an arity of at least 2" );
+
+   basic_priority( std::size_t const /* max_size */ ) {
+   }
+
+   void push( OBJ_TYPE const & t ) {
+      emplace( t );
+   }
+
+   void push( OBJ_TYPE && t ) {
+      emplace( std::move( t ) );
+   }
+
+   template< typename ... ARGS >
+   void emplace( ARGS && ... args ) {
+      heap_.emplace_back( std::forward< ARGS >( args ) ... );
+      sift_up( heap_.size() - 1 );
+   }
+
+   std::size_t size() const {
+      return heap_.size();
+   }
+
+   OBJ_TYPE pop() {
+      OBJ_TYPE rval( std::move( heap_.front() ) );
+      if( heap_.size() > 1 ) {
+         OBJ_TYPE last( std::move( heap_.back() ) );
+         heap_.pop_back();
+         sift_down( std::move( last ) );
+      } else {
+         heap_.pop_back();
+      }
+      return rval;
+   }
+
+   bool empty() const {
+      return heap_.empty();
+   }
+
+private:
+   // Moves the object at i up until its parent is not less.
+   void sift_up( std::size_t i ) {
+      if( i == 0 ) {
+         return;
+      }
+      OBJ_TYPE t( std::move( heap_[ i ] ) );
+      while( i > 0 ) {
+         std::size_t const parent( ( i - 1 ) / ARITY );
+         if( not compare_( heap_[ parent ], t ) ) {
+            break;
+         }
+         heap_[ i ] = std::move( heap_[ parent ] );
+         i = parent;
+      }
+      heap_[ i ] = std::move( t );
+   }
+
+   // Places t into the hole at the root: moves the largest child
+   // up until no child is larger than t.
+   void sift_down( OBJ_TYPE && t ) {
+      std::size_t const n( heap_.size() );
+      std::size_t i( 0 );
+      while( true ) {
+         std::size_t const first( i * ARITY + 1 );
+         if( first >= n ) {
+            break;
+         }
+         std::size_t const last( std::min( first + ARITY, n ) );
+         std::size_t best( first );
+         for( std::size_t c( first + 1 ); c < last; ++c ) {
+            if( compare_( heap_[ best ], heap_[ c ] ) ) {
+               best = c;
+            }
+         }
+         if( not compare_( t, heap_[ best ] ) ) {
+            break;
+         }
+         heap_[ i ] = std::move( heap_[ best ] );
+         i = best;
+      }
+      heap_[ i ] = std::move( t );
+   }
+
+   std::vector< OBJ_TYPE > heap_;
+   COMPARE compare_;
+};
+
+template< typename OBJ_TYPE >
+using priority = basic_priority< OBJ_TYPE >;
+
+// The default for bucket_priority: uses the priority() member
+// function of the object.
+template< typename OBJ_TYPE >
+class priority_member {
+public:
+   std::size_t operator()( OBJ_TYPE const & t ) const {
+      return t.priority();
+   }
+};
+
+/*
+ * Priority queue for a small range of integer priorities
+ * [0, LEVELS): one FIFO per priority plus a bit mask of the non
+ * empty FIFOs - so push and pop are O(1).  The highest priority is
+ * popped first; objects with the same priority are popped in FIFO
+ * order.  PRIORITY_OF returns the priority of an object; a
+ * priority which is not less than LEVELS is a programming bug.
+ */
+template< typename OBJ_TYPE,
+          typename PRIORITY_OF = priority_member< OBJ_TYPE >,
+          std::size_t LEVELS = 8 >
+class basic_bucket_priority {
+public:
+   static_assert( LEVELS >= 1 and LEVELS <= 64,
+                  "bucket_priority supports 1 to 64 levels" );
+
+   basic_bucket_priority( std::size_t const /* max_size */ )
+      : non_empty_( 0 ),
+        size_( 0 ) {
+   }
+
+   void push( OBJ_TYPE const & t ) {
+      bucket( t ).push_back( t );
+      ++size_;
+   }
+
+   void push( OBJ_TYPE && t ) {
+      std::deque< OBJ_TYPE > & b( bucket( t ) );
+      b.push_back( std::move( t ) );
+      ++size_;
+   }
+
+   // The priority is only known when the object was constructed.
+   template< typename ... ARGS >
+   void emplace( ARGS && ... args ) {
+      push( OBJ_TYPE( std::forward< ARGS >( args ) ... ) );
+   }
+
+   std::size_t size() const {
+      return size_;
+   }
+
+   OBJ_TYPE pop() {
+      std::size_t const level( detail::highest_bit( non_empty_ ) );
+      std::deque< OBJ_TYPE > & b( buckets_[ level ] );
+      OBJ_TYPE rval( std::move( b.front() ) );
+      b.pop_front();
+      if( b.empty() ) {
+         non_empty_ &= ~( std::uint64_t( 1 ) << level );
       }
+      --size_;
+      return rval;
    }
 
-   void register_terminator() {
-      if( started_ ) {
-         // This should never happen: programing bug:
-         // Start was already called - before finishing to register
-         // all terminators.
-         abort();
-      }
-      ++terminate_cnt_;
+   bool empty() const {
+      return size_ == 0;
    }
 
 private:
-   bool started_;
-   long terminate_cnt_;
+   std::deque< OBJ_TYPE > & bucket( OBJ_TYPE const & t ) {
+      std::size_t const level( priority_of_( t ) );
+      if( level >= LEVELS ) {
+         // Programming bug: priority out of range.
+         abort();
+      }
+      non_empty_ |= std::uint64_t( 1 ) << level;
+      return buckets_[ level ];
+   }
 
-   std::condition_variable cv_wait_for_start_;
-   std::condition_variable cv_wait_for_termination_;
+   std::array< std::deque< OBJ_TYPE >, LEVELS > buckets_;
+   std::uint64_t non_empty_;
+   std::size_t size_;
+   PRIORITY_OF priority_of_;
 };
 
-// XXX To implement
-// XXX To test
-class run_forever {
-};
+template< typename OBJ_TYPE >
+using bucket_priority = basic_bucket_priority< OBJ_TYPE >;
 
-}
+// The default for coalescing: uses the key() member function of the
+// object.
+template< typename OBJ_TYPE >
+class key_member {
+public:
+   auto operator()( OBJ_TYPE const & t ) const -> decltype( t.key() ) {
+      return t.key();
+   }
+};
 
 /*
- * This is an abstraction of the underlaying container.
- * Currently only a queue is implemented.
+ * FIFO which coalesces objects with the same key: when an object is
+ * pushed while an object with the same key is pending, the pending
+ * one is replaced (move assigned) and keeps its position.  An index
+ * from the key to the position makes this O(1), so the size is
+ * bounded by the number of distinct keys.  KEY_OF returns the key
+ * of an object; HASH hashes the key.
+ * push() / emplace() return false when a pending object was
+ * replaced: the pool neither counts nor notifies such a push.
+ * Please note, that a push to a full pool waits even when it would
+ * replace a pending object.
  */
-namespace container {
-
-template< typename OBJ_TYPE >
-class queue {
+template< typename OBJ_TYPE,
+          typename KEY_OF = key_member< OBJ_TYPE >,
+          typename HASH = std::hash< typename std::decay<
+             decltype( std::declval< KEY_OF const & >()(
+                          std::declval< OBJ_TYPE const & >() ) ) >::type > >
+class basic_coalescing {
 public:
-   void push( OBJ_TYPE const & t ) {
-      queue_.push( t );
+   using key_type = typename std::decay<
+      decltype( std::declval< KEY_OF const & >()(
+                   std::declval< OBJ_TYPE const & >() ) ) >::type;
+
+   basic_coalescing( std::size_t const max_size )
+      : head_( 0 ) {
+      index_.reserve( std::min( max_size, max_reserve ) );
+   }
+
+   // Returns true when t was inserted, false when it replaced the
+   // pending object with the same key.
+   bool push( OBJ_TYPE const & t ) {
+      return push_( t );
+   }
+
+   bool push( OBJ_TYPE && t ) {
+      return push_( std::move( t ) );
+   }
+
+   // The key is only known when the object was constructed.
+   template< typename ... ARGS >
+   bool emplace( ARGS && ... args ) {
+      return push( OBJ_TYPE( std::forward< ARGS >( args ) ... ) );
    }
 
    std::size_t size() const {
-      return queue_.size();
+      return objects_.size();
    }
 
    OBJ_TYPE pop() {
-      OBJ_TYPE rval( queue_.front() );
-      queue_.pop();
+      OBJ_TYPE rval( std::move( objects_.front() ) );
+      objects_.pop_front();
+      index_.erase( key_of_( rval ) );
+      ++head_;
       return rval;
    }
 
-   bool empty() {
-      return queue_.empty();
+   bool empty() const {
+      return objects_.empty();
    }
 
 private:
-   std::queue< OBJ_TYPE > queue_;
+   static std::size_t const max_reserve = 1024;
+
+   // The object is added before the index entry: when either throws,
+   // the index never refers to a missing object.
+   template< typename T >
+   bool push_( T && t ) {
+      key_type key( key_of_( t ) );
+      auto const found( index_.find( key ) );
+      if( found != index_.end() ) {
+         objects_[ found->second - head_ ] = std::forward< T >( t );
+         return false;
+      }
+      objects_.push_back( std::forward< T >( t ) );
+      try {
+         index_.emplace( std::move( key ), head_ + objects_.size() - 1 );
+      } catch( ... ) {
+         objects_.pop_back();
+         throw;
+      }
+      return true;
+   }
+
+   std::deque< OBJ_TYPE > objects_;
+   // Key -> sequence number; the position is sequence - head_.
+   std::unordered_map< key_type, std::uint64_t, HASH > index_;
+   // The sequence number of the front object.
+   std::uint64_t head_;
+   KEY_OF key_of_;
 };
 
+template< typename OBJ_TYPE, typename KEY_OF, typename HASH >
+std::size_t const basic_coalescing< OBJ_TYPE, KEY_OF, HASH >::max_reserve;
+
+template< typename OBJ_TYPE >
+using coalescing = basic_coalescing< OBJ_TYPE >;
+
 }
 
 /*
  * o size_handling::constant / size_handling::unlimited
  *   The constant size handling allows a constant number
  *   of objects. The unlimited allows unlimited number
- *   of elements.
+ *   of elements; it must be used together with a container which
+ *   grows on demand (e.g. queue, segmented or ws_deque) - not with
+ *   a preallocating ring.
  */
 
 namespace size_handling {
@@ -225,17 +1938,222 @@ public:
       : max_size_( max_size ) {
    }
 
-   bool free_slot_available( std::size_t const cur_size ) {
+   bool free_slot_available( std::size_t const cur_size ) const {
       return cur_size < max_size_;
    }
 
+   std::size_t max_size() const {
+      return max_size_;
+   }
+
 private:
    std::size_t max_size_;
 };
 
-// XXX To implement
-// XXX To test
 class unlimited {
+public:
+   bool free_slot_available( std::size_t const /* cur_size */ ) const {
+      return true;
+   }
+
+   std::size_t max_size() const {
+      return std::numeric_limits< std::size_t >::max();
+   }
+};
+
+}
+
+/*
+ * o stats::none / stats::counting
+ *   Records (or not) what happens in the pool; snapshot() returns
+ *   the current values without taking any lock.
+ *   none does nothing at all (and does not even read the clock).
+ *   counting keeps the counters per thread (striped by the thread
+ *   index, one stripe per cache line) so that threads do not
+ *   compete for the same cache line.  The clock is read for each
+ *   push and pop: the dwell time is the sum of all pop times minus
+ *   the sum of all push times (plus now for every object still in
+ *   the pool) - this needs no time stamp per object.
+ *   The hooks are called by the pool: pushed() / popped() after n
+ *   objects were pushed / popped, producer_waited() /
+ *   consumer_waited() after a wait which started at 'start' and
+ *   locked() with every data path lock.
+ */
+namespace stats {
+
+class none {
+public:
+   class time_point {};
+
+   time_point now() const {
+      return time_point();
+   }
+
+   template< typename CONTAINER >
+   void pushed( std::size_t const, CONTAINER const & ) {}
+   void popped( std::size_t const ) {}
+   void producer_waited( time_point const & ) {}
+   void consumer_waited( time_point const & ) {}
+
+   template< typename LOCK >
+   void locked( LOCK const & ) {}
+
+   stats_snapshot snapshot() const {
+      return stats_snapshot();
+   }
+};
+
+class counting {
+public:
+   using clock = std::chrono::steady_clock;
+   using time_point = clock::time_point;
+
+   counting()
+      : created_( clock::now() ),
+        count_( std::max( std::thread::hardware_concurrency(), 1U ) ),
+        stripes_( new stripe[ count_ ] ),
+        high_water_mark_( 0 ) {
+   }
+
+   counting( counting const & ) = delete;
+   counting & operator=( counting const & ) = delete;
+
+   time_point now() const {
+      return clock::now();
+   }
+
+   template< typename CONTAINER >
+   void pushed( std::size_t const n, CONTAINER const & container ) {
+      stripe & s( local() );
+      add( s.pushes, n );
+      add( s.push_times, n * since_created( now() ) );
+
+      std::size_t const size( container.size() );
+      std::size_t hwm( high_water_mark_.load( std::memory_order_relaxed ) );
+      while( size > hwm
+             and not high_water_mark_.compare_exchange_weak(
+                hwm, size, std::memory_order_relaxed ) ) {
+      }
+   }
+
+   void popped( std::size_t const n ) {
+      stripe & s( local() );
+      add( s.pops, n );
+      add( s.pop_times, n * since_created( now() ) );
+   }
+
+   void producer_waited( time_point const & start ) {
+      stripe & s( local() );
+      add( s.producer_waits, 1 );
+      add( s.producer_wait_ns, since( start ) );
+   }
+
+   void consumer_waited( time_point const & start ) {
+      stripe & s( local() );
+      add( s.consumer_waits, 1 );
+      add( s.consumer_wait_ns, since( start ) );
+   }
+
+   template< typename LOCK >
+   void locked( LOCK const & lock ) {
+      if( lock.contended() ) {
+         add( local().contended_locks, 1 );
+      }
+   }
+
+   // Only a snapshot when used concurrently.
+   stats_snapshot snapshot() const {
+      stats_snapshot rval;
+      std::uint64_t push_times( 0 );
+      std::uint64_t pop_times( 0 );
+      std::uint64_t producer_wait_ns( 0 );
+      std::uint64_t consumer_wait_ns( 0 );
+      for( std::size_t i( 0 ); i < count_; ++i ) {
+         stripe const & s( stripes_[ i ] );
+         rval.pushes += get( s.pushes );
+         rval.pops += get( s.pops );
+         rval.producer_waits += get( s.producer_waits );
+         producer_wait_ns += get( s.producer_wait_ns );
+         rval.consumer_waits += get( s.consumer_waits );
+         consumer_wait_ns += get( s.consumer_wait_ns );
+         rval.contended_locks += get( s.contended_locks );
+         push_times += get( s.push_times );
+         pop_times += get( s.pop_times );
+      }
+      rval.producer_wait_time = to_ns( producer_wait_ns );
+      rval.consumer_wait_time = to_ns( consumer_wait_ns );
+      rval.high_water_mark =
+         high_water_mark_.load( std::memory_order_relaxed );
+
+      // The sums of the time stamps might overflow: the difference
+      // (computed modulo 2^64) is still correct.
+      std::uint64_t const in_pool(
+         rval.pushes > rval.pops ? rval.pushes - rval.pops : 0 );
+      std::int64_t const dwell( static_cast< std::int64_t >(
+         pop_times + in_pool * since_created( now() ) - push_times ) );
+      rval.dwell_time = to_ns(
+         dwell > 0 ? static_cast< std::uint64_t >( dwell ) : 0 );
+      return rval;
+   }
+
+private:
+   class stripe {
+   public:
+      stripe()
+         : pushes( 0 ), pops( 0 ), push_times( 0 ), pop_times( 0 ),
+           producer_waits( 0 ), producer_wait_ns( 0 ),
+           consumer_waits( 0 ), consumer_wait_ns( 0 ),
+           contended_locks( 0 ) {
+      }
+
+      std::atomic< std::uint64_t > pushes;
+      std::atomic< std::uint64_t > pops;
+      std::atomic< std::uint64_t > push_times;
+      std::atomic< std::uint64_t > pop_times;
+      std::atomic< std::uint64_t > producer_waits;
+      std::atomic< std::uint64_t > producer_wait_ns;
+      std::atomic< std::uint64_t > consumer_waits;
+      std::atomic< std::uint64_t > consumer_wait_ns;
+      std::atomic< std::uint64_t > contended_locks;
+      char pad_[ detail::cache_line_size ];
+   };
+
+   static void add( std::atomic< std::uint64_t > & a,
+                    std::uint64_t const v ) {
+      a.fetch_add( v, std::memory_order_relaxed );
+   }
+
+   static std::uint64_t get( std::atomic< std::uint64_t > const & a ) {
+      return a.load( std::memory_order_relaxed );
+   }
+
+   static std::chrono::nanoseconds to_ns( std::uint64_t const ns ) {
+      return std::chrono::nanoseconds(
+         static_cast< std::chrono::nanoseconds::rep >( ns ) );
+   }
+
+   static std::uint64_t ns( clock::duration const & d ) {
+      return static_cast< std::uint64_t >(
+         std::chrono::duration_cast< std::chrono::nanoseconds >(
+            d ).count() );
+   }
+
+   std::uint64_t since( time_point const & start ) const {
+      return ns( now() - start );
+   }
+
+   std::uint64_t since_created( time_point const & t ) const {
+      return ns( t - created_ );
+   }
+
+   stripe & local() {
+      return stripes_[ detail::thread_index() % count_ ];
+   }
+
+   time_point const created_;
+   std::size_t const count_;
+   std::unique_ptr< stripe[] > const stripes_;
+   std::atomic< std::size_t > high_water_mark_;
 };
 
 }
@@ -252,57 +2170,247 @@ template< typename OBJ_TYPE,
              class POLICIY_TERMINATION,
           template< typename OBJ_TYPE_1 >
              class POLICIY_CONTAINER,
-          typename POLICIY_SIZE_HANDLING >
+          typename POLICIY_SIZE_HANDLING,
+          typename POLICIY_STATS = policies::stats::none >
 class pool {
 public:
+   using value_type = OBJ_TYPE;
+
    pool( POLICIY_SIZE_HANDLING const & size_handling )
-     : size_handling_( size_handling ) {
+     : container_( size_handling.max_size() ),
+       size_handling_( size_handling ) {
+   }
+
+   /*
+    * For policies which share state (e.g. threading::process_shared
+    * which owns a shared memory segment): the threading policy is
+    * constructed with 'args', the notify, termination and container
+    * policies with the threading policy.
+    */
+   template< typename ... ARGS >
+   pool( POLICIY_SIZE_HANDLING const & size_handling, ARGS && ... args )
+     : threading_( std::forward< ARGS >( args ) ... ),
+       notify_not_full_( threading_ ),
+       notify_not_empty_( threading_ ),
+       termination_( threading_ ),
+       container_( size_handling.max_size(), threading_ ),
+       size_handling_( size_handling ) {
    }
 
    void push( OBJ_TYPE const & t ) {
+      emplace( t );
+   }
+
+   void push( OBJ_TYPE && t ) {
+      emplace( std::move( t ) );
+   }
+
+   // Constructs the object in place in the container.
+   template< typename ... ARGS >
+   void emplace( ARGS && ... args ) {
+      emplace_( [this]( typename POLICIY_THREADING::lock & lock ) {
+            wait_not_full_( lock );
+            return true; },
+         std::forward< ARGS >( args ) ... );
+   }
+
+   /*
+    * Non blocking and timed push functions: they return false
+    * (and do not use / move from the arguments) when the pool is
+    * full / still full at the deadline.
+    */
+   bool try_push( OBJ_TYPE const & t ) {
+      return try_emplace( t );
+   }
+
+   bool try_push( OBJ_TYPE && t ) {
+      return try_emplace( std::move( t ) );
+   }
+
+   template< typename ... ARGS >
+   bool try_emplace( ARGS && ... args ) {
+      return emplace_( []( typename POLICIY_THREADING::lock & ) {
+            return false; },
+         std::forward< ARGS >( args ) ... );
+   }
+
+   template< typename REP, typename PERIOD >
+   bool push_for( OBJ_TYPE const & t,
+                  std::chrono::duration< REP, PERIOD > const & d ) {
+      return push_until( t, std::chrono::steady_clock::now() + d );
+   }
+
+   template< typename REP, typename PERIOD >
+   bool push_for( OBJ_TYPE && t,
+                  std::chrono::duration< REP, PERIOD > const & d ) {
+      return push_until(
+         std::move( t ), std::chrono::steady_clock::now() + d );
+   }
+
+   template< typename CLOCK, typename DURATION >
+   bool push_until(
+      OBJ_TYPE const & t,
+      std::chrono::time_point< CLOCK, DURATION > const & deadline ) {
+      return emplace_until( deadline, t );
+   }
+
+   template< typename CLOCK, typename DURATION >
+   bool push_until(
+      OBJ_TYPE && t,
+      std::chrono::time_point< CLOCK, DURATION > const & deadline ) {
+      return emplace_until( deadline, std::move( t ) );
+   }
+
+   template< typename CLOCK, typename DURATION, typename ... ARGS >
+   bool emplace_until(
+      std::chrono::time_point< CLOCK, DURATION > const & deadline,
+      ARGS && ... args ) {
+      return emplace_(
+         [this, &deadline]( typename POLICIY_THREADING::lock & lock ) {
+            return wait_not_full_until_( lock, deadline ); },
+         std::forward< ARGS >( args ) ... );
+   }
+
+   /*
+    * Pushes all elements of [first, last) with one lock acquisition
+    * and one notification.  Only when the pool gets full in between,
+    * the consumers are notified and the producer waits for space.
+    */
+   template< typename INPUT_IT >
+   void push_bulk( INPUT_IT first, INPUT_IT const last ) {
+      std::size_t pushed( 0 );
       {
          typename POLICIY_THREADING::lock lock( threading_ );
+         stats_.locked( lock );
          if( termination_.should_terminate() ) {
             // Try to push something in a termianted pool
             // -> implementation bug of non library source code.
             abort();
          }
 
-         while( not termination_.should_terminate()
-                and not size_handling_.free_slot_available(
-                   container_.size() ) ) {
-            notify_not_full_.wait( lock );
+         while( first != last ) {
+            bool added( false );
+            if( try_emplace_( locks_container(), added, *first ) ) {
+               ++first;
+               pushed += added ? 1 : 0;
+               continue;
+            }
+            notify_not_empty_.notify( pushed );
+            pushed = 0;
+            wait_not_full_( lock );
          }
-
-         container_.push( t );
       }
-      notify_not_empty_.notify();
+      notify_not_empty_.notify( pushed );
    }
 
    OBJ_TYPE pop() {
-      typename POLICIY_THREADING::lock lock( threading_ );
+      pop_result< OBJ_TYPE > rval( pop_or_closed() );
+      if( not rval ) {
+         // When the pool is empty and the termination flag was set,
+         // through out an appropriate exception.
+         throw ptl::object_pool::terminate_except();
+      }
+      return std::move( *rval );
+   }
+
+   /*
+    * Like pop() - but instead of throwing a terminate_except the
+    * returned result has the status closed when the pool is
+    * terminated and drained.
+    */
+   pop_result< OBJ_TYPE > pop_or_closed() {
+      return pop_( [this]( typename POLICIY_THREADING::lock & lock ) {
+            wait_not_empty_( lock, [this]() { return can_pop_(); } );
+            return true; },
+         pop_status::closed );
+   }
+
+   /*
+    * Non blocking and timed pop functions: they never throw.
+    * Besides ok and closed, the status is empty (try_pop) or
+    * timeout (pop_for / pop_until) when nothing could be popped.
+    */
+   pop_result< OBJ_TYPE > try_pop() {
+      return pop_( []( typename POLICIY_THREADING::lock & ) {
+            return false; },
+         pop_status::empty );
+   }
+
+   template< typename REP, typename PERIOD >
+   pop_result< OBJ_TYPE > pop_for(
+      std::chrono::duration< REP, PERIOD > const & d ) {
+      return pop_until( std::chrono::steady_clock::now() + d );
+   }
 
-      while( not termination_.should_terminate()
-             and container_.empty() ){
-         notify_not_empty_.wait( lock );
+   template< typename CLOCK, typename DURATION >
+   pop_result< OBJ_TYPE > pop_until(
+      std::chrono::time_point< CLOCK, DURATION > const & deadline ) {
+      return pop_(
+         [this, &deadline]( typename POLICIY_THREADING::lock & lock ) {
+            return wait_not_empty_until_(
+               lock, [this]() { return can_pop_(); }, deadline ); },
+         pop_status::timeout );
+   }
+
+   /*
+    * Pops up to max_n elements into out with one lock acquisition
+    * and one notification.  Blocks until at least one element is
+    * available.  Returns the number of popped elements (0 when
+    * max_n is 0).
+    */
+   template< typename OUTPUT_IT >
+   std::size_t pop_bulk( OUTPUT_IT out, std::size_t const max_n ) {
+      if( max_n == 0 ) {
+         return 0;
       }
+      typename POLICIY_THREADING::lock lock( threading_ );
+      stats_.locked( lock );
 
-      // As long as there is some data in the queue, return this -
-      // even if the queue was already terminated.  (This ensures
-      // that all data in the system is handled before the
-      // thread / process stops.
-      if( not container_.empty() ) {
-         OBJ_TYPE const rval( container_.pop() );
-         if( size_handling_.free_slot_available(
-                container_.size() ) ) {
-            notify_not_full_.notify();
+      std::size_t n( 0 );
+      while( ( n = pop_n_( out, max_n, locks_container() ) ) == 0 ) {
+         if( termination_.should_terminate() ) {
+            n = pop_n_terminated_( out, max_n );
+            break;
          }
-         return rval;
+         wait_not_empty_( lock, [this]() { return can_pop_(); } );
       }
+      notify_not_full_.notify( n );
+      return n;
+   }
+
+   /*
+    * Linger variant of pop_bulk: waits until at least min_n elements
+    * are available (or the deadline is reached) before popping up to
+    * max_n elements.  Returns the number of popped elements which
+    * might be less than min_n (or even 0) when the deadline was
+    * reached.
+    */
+   template< typename OUTPUT_IT, typename CLOCK, typename DURATION >
+   std::size_t pop_bulk(
+      OUTPUT_IT out, std::size_t const max_n, std::size_t const min_n,
+      std::chrono::time_point< CLOCK, DURATION > const & deadline ) {
+      if( max_n == 0 ) {
+         return 0;
+      }
+      typename POLICIY_THREADING::lock lock( threading_ );
+      stats_.locked( lock );
 
-      // When the pool is empty and the termination flag was set,
-      // through out an appropriate exception.
-      throw ptl::object_pool::terminate_except();
+      wait_not_empty_until_(
+         lock, [this, min_n]() {
+            return termination_.should_terminate()
+               or container_.size() >= min_n; },
+         deadline );
+
+      std::size_t n( pop_n_( out, max_n, locks_container() ) );
+      if( n == 0 ) {
+         if( not termination_.should_terminate() ) {
+            // Deadline reached
+            return 0;
+         }
+         n = pop_n_terminated_( out, max_n );
+      }
+      notify_not_full_.notify( n );
+      return n;
    }
 
    std::size_t size() {
@@ -310,30 +2418,62 @@ public:
       return container_.size();
    }
 
-   void start() {
+   // Only a snapshot when used concurrently.
+   bool full() {
       typename POLICIY_THREADING::lock lock( threading_ );
+      return not size_handling_.free_slot_available( container_.size() );
+   }
+
+   void start() {
+      typename POLICIY_THREADING::lifecycle_lock lock( threading_ );
       termination_.start();
    }
 
    void terminate() {
-      typename POLICIY_THREADING::lock lock( threading_ );
-      termination_.terminate( lock );
+      {
+         typename POLICIY_THREADING::lifecycle_lock lock( threading_ );
+         termination_.terminate( lock );
+      }
       // Also notify the not full and not empty that they can stop
       // processing.
-      notify_not_full_.notify();
-      notify_not_empty_.notify();
+      notify_not_full_.notify_all();
+      notify_not_empty_.notify_all();
    }
 
    void register_terminator() {
-      typename POLICIY_THREADING::lock lock( threading_ );
+      typename POLICIY_THREADING::lifecycle_lock lock( threading_ );
       termination_.register_terminator();
    }
 
+   // Only for containers with an owner thread (e.g. ws_deque):
+   // must be called by the owner before it pushes.
+   void register_owner() {
+      container_.register_owner();
+   }
+
+   // Only for not empty notify policies which support it (e.g.
+   // notify::selectable): the wakeup is signalled whenever objects
+   // are pushed or the pool is terminated.
+   template< typename WAKEUP >
+   void attach( WAKEUP & wakeup ) {
+      notify_not_empty_.attach( wakeup );
+   }
+
+   template< typename WAKEUP >
+   void detach( WAKEUP & wakeup ) {
+      notify_not_empty_.detach( wakeup );
+   }
+
    bool should_terminate() {
       typename POLICIY_THREADING::lock lock( threading_ );
       return termination_.should_terminate();
    }
 
+   // Does not lock: only a snapshot when used concurrently.
+   stats_snapshot snapshot() const {
+      return stats_.snapshot();
+   }
+
 private:
    POLICIY_THREADING threading_;
    POLICIY_NOTIFY_NOT_FULL< POLICIY_THREADING > notify_not_full_;
@@ -341,6 +2481,260 @@ private:
    POLICIY_TERMINATION< POLICIY_THREADING > termination_;
    POLICIY_CONTAINER< OBJ_TYPE > container_;
    POLICIY_SIZE_HANDLING size_handling_;
+   POLICIY_STATS stats_;
+
+   using locks_container = std::integral_constant< bool,
+      POLICIY_THREADING::locks_container::value
+      and not detail::has_try_pop<
+         POLICIY_CONTAINER< OBJ_TYPE >, OBJ_TYPE >::value >;
+
+   // The container is protected by the lock: after termination
+   // the push is always done (even if the pool is full).
+   bool can_push_( std::true_type ) const {
+      return termination_.should_terminate()
+         or size_handling_.free_slot_available( container_.size() );
+   }
+
+   // The container does its own synchronization: it can never
+   // hold more than its capacity.
+   bool can_push_( std::false_type ) const {
+      return size_handling_.free_slot_available( container_.size() );
+   }
+
+   // The arguments are only used (moved from) when the object
+   // was really pushed.  'added' is set to false when the container
+   // did not add an object (e.g. it replaced a pending one): this is
+   // neither counted nor notified.
+   template< typename ... ARGS >
+   bool try_emplace_( std::true_type, bool & added, ARGS && ... args ) {
+      if( not can_push_( std::true_type() ) ) {
+         return false;
+      }
+      added = emplace_into_( container_,
+                             std::forward< ARGS >( args ) ... );
+      if( added ) {
+         stats_.pushed( 1, container_ );
+      }
+      return true;
+   }
+
+   template< typename ... ARGS >
+   bool try_emplace_( std::false_type, bool & added, ARGS && ... args ) {
+      if( not container_.try_emplace( std::forward< ARGS >( args ) ... ) ) {
+         return false;
+      }
+      added = true;
+      stats_.pushed( 1, container_ );
+      return true;
+   }
+
+   template< typename CONTAINER, typename ... ARGS >
+   static auto emplace_into_( CONTAINER & c, ARGS && ... args )
+      -> typename std::enable_if<
+         std::is_same< decltype( c.emplace(
+                          std::forward< ARGS >( args ) ... ) ),
+                       bool >::value, bool >::type {
+      return c.emplace( std::forward< ARGS >( args ) ... );
+   }
+
+   template< typename CONTAINER, typename ... ARGS >
+   static auto emplace_into_( CONTAINER & c, ARGS && ... args )
+      -> typename std::enable_if<
+         std::is_void< decltype( c.emplace(
+                          std::forward< ARGS >( args ) ... ) ) >::value,
+         bool >::type {
+      c.emplace( std::forward< ARGS >( args ) ... );
+      return true;
+   }
+
+   // The waits for the not full / not empty condition; the time is
+   // only taken when the caller really has to wait.
+   void wait_not_full_( typename POLICIY_THREADING::lock & lock ) {
+      auto const pred( [this]() { return can_push_( locks_container() ); } );
+      if( pred() ) {
+         return;
+      }
+      typename POLICIY_STATS::time_point const start( stats_.now() );
+      notify_not_full_.wait( lock, pred );
+      stats_.producer_waited( start );
+   }
+
+   template< typename CLOCK, typename DURATION >
+   bool wait_not_full_until_(
+      typename POLICIY_THREADING::lock & lock,
+      std::chrono::time_point< CLOCK, DURATION > const & deadline ) {
+      auto const pred( [this]() { return can_push_( locks_container() ); } );
+      if( pred() ) {
+         return true;
+      }
+      typename POLICIY_STATS::time_point const start( stats_.now() );
+      bool const rval( notify_not_full_.wait_until( lock, pred, deadline ) );
+      stats_.producer_waited( start );
+      return rval;
+   }
+
+   template< typename PRED >
+   void wait_not_empty_( typename POLICIY_THREADING::lock & lock,
+                         PRED pred ) {
+      if( pred() ) {
+         return;
+      }
+      typename POLICIY_STATS::time_point const start( stats_.now() );
+      notify_not_empty_.wait( lock, pred );
+      stats_.consumer_waited( start );
+   }
+
+   template< typename PRED, typename CLOCK, typename DURATION >
+   bool wait_not_empty_until_(
+      typename POLICIY_THREADING::lock & lock, PRED pred,
+      std::chrono::time_point< CLOCK, DURATION > const & deadline ) {
+      if( pred() ) {
+         return true;
+      }
+      typename POLICIY_STATS::time_point const start( stats_.now() );
+      bool const rval( notify_not_empty_.wait_until( lock, pred, deadline ) );
+      stats_.consumer_waited( start );
+      return rval;
+   }
+
+   bool can_pop_() const {
+      return termination_.should_terminate() or not container_.empty();
+   }
+
+   template< typename OUTPUT_IT >
+   std::size_t pop_n_( OUTPUT_IT & out, std::size_t const max_n,
+                       std::true_type ) {
+      std::size_t n( 0 );
+      while( n < max_n and not container_.empty() ) {
+         *out = container_.pop();
+         ++out;
+         ++n;
+      }
+      if( n > 0 ) {
+         stats_.popped( n );
+      }
+      return n;
+   }
+
+   template< typename OUTPUT_IT >
+   std::size_t pop_n_( OUTPUT_IT & out, std::size_t const max_n,
+                       std::false_type ) {
+      std::size_t n( 0 );
+      OBJ_TYPE t;
+      while( n < max_n and container_.try_pop( t ) ) {
+         *out = std::move( t );
+         ++out;
+         ++n;
+      }
+      if( n > 0 ) {
+         stats_.popped( n );
+      }
+      return n;
+   }
+
+   // Called when nothing could be popped from a terminated pool:
+   // all pushes happened before the termination - so when this
+   // also fails, the pool is really drained.
+   template< typename OUTPUT_IT >
+   std::size_t pop_n_terminated_( OUTPUT_IT & out,
+                                  std::size_t const max_n ) {
+      std::size_t const n( pop_n_( out, max_n, locks_container() ) );
+      if( n == 0 ) {
+         throw ptl::object_pool::terminate_except();
+      }
+      return n;
+   }
+
+   /*
+    * Pushes one object.  When the pool is full, 'wait' is called
+    * which waits for a free slot; it returns false when the caller
+    * does not want to wait any longer.
+    */
+   template< typename WAIT, typename ... ARGS >
+   bool emplace_( WAIT wait, ARGS && ... args ) {
+      bool added( false );
+      {
+         typename POLICIY_THREADING::lock lock( threading_ );
+         stats_.locked( lock );
+         if( termination_.should_terminate() ) {
+            // Try to push something in a termianted pool
+            // -> implementation bug of non library source code.
+            abort();
+         }
+
+         while( not try_emplace_(
+                   locks_container(), added,
+                   std::forward< ARGS >( args ) ... ) ) {
+            if( not wait( lock ) ) {
+               return false;
+            }
+         }
+      }
+      if( added ) {
+         notify_not_empty_.notify();
+      }
+      return true;
+   }
+
+   /*
+    * Pops one object.  When the pool is empty (and not terminated),
+    * 'wait' is called which waits for an object; it returns false
+    * when the caller does not want to wait any longer - then an
+    * empty result with the status 'give_up' is returned.
+    */
+   template< typename WAIT >
+   pop_result< OBJ_TYPE > pop_( WAIT wait, pop_status const give_up ) {
+      typename POLICIY_THREADING::lock lock( threading_ );
+      stats_.locked( lock );
+
+      while( true ) {
+         // As long as there is some data in the queue, return this -
+         // even if the queue was already terminated.  (This ensures
+         // that all data in the system is handled before the
+         // thread / process stops.
+         pop_result< OBJ_TYPE > rval( take_( locks_container() ) );
+         if( rval ) {
+            return rval;
+         }
+
+         if( termination_.should_terminate() ) {
+            // All pushes happened before the termination: so when
+            // this also fails, the pool is really drained.
+            pop_result< OBJ_TYPE > last( take_( locks_container() ) );
+            if( last ) {
+               return last;
+            }
+            return pop_result< OBJ_TYPE >( pop_status::closed );
+         }
+
+         if( not wait( lock ) ) {
+            return pop_result< OBJ_TYPE >( give_up );
+         }
+      }
+   }
+
+   pop_result< OBJ_TYPE > take_( std::true_type ) {
+      if( container_.empty() ) {
+         return pop_result< OBJ_TYPE >( pop_status::empty );
+      }
+      pop_result< OBJ_TYPE > rval( container_.pop() );
+      stats_.popped( 1 );
+      if( size_handling_.free_slot_available(
+             container_.size() ) ) {
+         notify_not_full_.notify();
+      }
+      return rval;
+   }
+
+   pop_result< OBJ_TYPE > take_( std::false_type ) {
+      OBJ_TYPE t;
+      if( not container_.try_pop( t ) ) {
+         return pop_result< OBJ_TYPE >( pop_status::empty );
+      }
+      stats_.popped( 1 );
+      notify_not_full_.notify();
+      return pop_result< OBJ_TYPE >( std::move( t ) );
+   }
 };
 
 }}
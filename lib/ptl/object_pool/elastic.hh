@@ -0,0 +1,227 @@
+#ifndef PTL_OBJECT_POOL_ELASTIC_HH
+#define PTL_OBJECT_POOL_ELASTIC_HH
+
+#include <ptl/object_pool.hh>
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+/*
+ * Elastic consumers
+ * A set of consumer threads of one pool which grows and shrinks with
+ * the load: a controller thread samples the pool every interval and
+ * starts another consumer when there are more than max_depth objects
+ * in the pool or when the objects recently waited longer than
+ * max_dwell_time in the pool (this needs stats::counting).  A consumer
+ * which did not get an object for idle_time retires - as long as
+ * more than min_consumers are running.
+ * The consumers run until the pool is terminated (by its producers
+ * with register_terminator() / terminate()) and drained; join()
+ * waits for this.  The pool must outlive the elastic consumers.
+ */
+namespace ptl { namespace object_pool {
+
+class elastic_limits {
+public:
+   elastic_limits()
+      : min_consumers( 1 ),
+        max_consumers(
+           std::max( std::thread::hardware_concurrency(), 1U ) ),
+        max_depth( 16 ),
+        max_dwell_time( std::chrono::milliseconds( 10 ) ),
+        idle_time( std::chrono::seconds( 1 ) ),
+        interval( std::chrono::milliseconds( 10 ) ) {
+   }
+
+   std::size_t min_consumers;
+   std::size_t max_consumers;
+   // Start a consumer when the pool holds more objects ...
+   std::size_t max_depth;
+   // ... or when objects wait longer on average.
+   std::chrono::nanoseconds max_dwell_time;
+   // A consumer retires after this time without an object.
+   std::chrono::nanoseconds idle_time;
+   // The controller samples the pool in this interval.
+   std::chrono::nanoseconds interval;
+};
+
+template< typename POOL, typename CONSUME >
+class elastic_consumers {
+public:
+   using value_type = typename POOL::value_type;
+
+   // consume( value_type && ) is called for each object.
+   elastic_consumers( POOL & pool, CONSUME consume,
+                      elastic_limits const & limits = elastic_limits() )
+      : pool_( pool ),
+        consume_( consume ),
+        limits_( limits ),
+        running_( 0 ),
+        started_( 0 ),
+        closed_( false ) {
+      if( limits_.min_consumers == 0
+          or limits_.min_consumers > limits_.max_consumers ) {
+         // Programming bug: the limits are inconsistent.
+         abort();
+      }
+      std::unique_lock< std::mutex > lock( mutex_ );
+      while( running_ < limits_.min_consumers ) {
+         start_consumer_( lock );
+      }
+      last_ = pool_.snapshot();
+      controller_ = std::thread( [this]() { control(); } );
+   }
+
+   ~elastic_consumers() {
+      join();
+   }
+
+   elastic_consumers( elastic_consumers const & ) = delete;
+   elastic_consumers & operator=( elastic_consumers const & ) = delete;
+
+   // Waits until the pool is terminated and drained.
+   void join() {
+      if( controller_.joinable() ) {
+         controller_.join();
+      }
+   }
+
+   // The number of currently running consumers.
+   std::size_t consumers() {
+      std::unique_lock< std::mutex > lock( mutex_ );
+      return running_;
+   }
+
+   // The number of consumers started so far (including retired ones).
+   std::size_t started() {
+      std::unique_lock< std::mutex > lock( mutex_ );
+      return started_;
+   }
+
+private:
+   class consumer {
+   public:
+      consumer()
+         : done( false ) {
+      }
+
+      std::thread thread;
+      bool done;
+   };
+
+   void start_consumer_( std::unique_lock< std::mutex > & ) {
+      consumers_.emplace_back();
+      consumer & c( consumers_.back() );
+      ++running_;
+      ++started_;
+      c.thread = std::thread( [this, &c]() { consume( c ); } );
+   }
+
+   void consume( consumer & c ) {
+      while( true ) {
+         pop_result< value_type > r( pool_.pop_for( limits_.idle_time ) );
+         if( r ) {
+            consume_( std::move( *r ) );
+            continue;
+         }
+         std::unique_lock< std::mutex > lock( mutex_ );
+         if( r.status() == pop_status::closed
+             or running_ > limits_.min_consumers ) {
+            --running_;
+            c.done = true;
+            if( r.status() == pop_status::closed ) {
+               closed_ = true;
+            }
+            cv_.notify_all();
+            return;
+         }
+      }
+   }
+
+   // Samples the pool and starts consumers; reaps retired ones.
+   void control() {
+      std::unique_lock< std::mutex > lock( mutex_ );
+      while( not ( closed_ and running_ == 0 ) ) {
+         cv_.wait_for( lock, limits_.interval );
+         reap( lock );
+         if( closed_ or running_ >= limits_.max_consumers ) {
+            continue;
+         }
+         lock.unlock();
+         bool const overloaded( overloaded_() );
+         lock.lock();
+         if( overloaded and not closed_
+             and running_ < limits_.max_consumers ) {
+            start_consumer_( lock );
+         }
+      }
+      reap( lock );
+   }
+
+   /*
+    * The dwell time of the last interval: Little's law gives the sum
+    * of the times all objects spent in the pool; divided by the
+    * number of new objects this is the mean wait time.
+    */
+   bool overloaded_() {
+      if( pool_.size() > limits_.max_depth ) {
+         return true;
+      }
+      stats_snapshot const now( pool_.snapshot() );
+      std::chrono::nanoseconds const dwell(
+         now.dwell_time - last_.dwell_time );
+      std::uint64_t const pushes(
+         std::max( now.pushes - last_.pushes, std::uint64_t( 1 ) ) );
+      last_ = now;
+      return dwell / static_cast< long >( pushes ) > limits_.max_dwell_time;
+   }
+
+   void reap( std::unique_lock< std::mutex > & lock ) {
+      for( typename std::list< consumer >::iterator it( consumers_.begin() );
+           it != consumers_.end(); ) {
+         if( not it->done ) {
+            ++it;
+            continue;
+         }
+         std::thread t( std::move( it->thread ) );
+         it = consumers_.erase( it );
+         lock.unlock();
+         t.join();
+         lock.lock();
+      }
+   }
+
+   POOL & pool_;
+   CONSUME consume_;
+   elastic_limits const limits_;
+
+   std::mutex mutex_;
+   std::condition_variable cv_;
+   std::list< consumer > consumers_;
+   std::size_t running_;
+   std::size_t started_;
+   bool closed_;
+   // Only used by the controller.
+   stats_snapshot last_;
+   std::thread controller_;
+};
+
+// Deduces the type of the consume function.
+template< typename POOL, typename CONSUME >
+std::unique_ptr< elastic_consumers< POOL, CONSUME > >
+make_elastic_consumers( POOL & pool, CONSUME consume,
+                        elastic_limits const & limits = elastic_limits() ) {
+   return std::unique_ptr< elastic_consumers< POOL, CONSUME > >(
+      new elastic_consumers< POOL, CONSUME >( pool, consume, limits ) );
+}
+
+}}
+
+#endif
@@ -0,0 +1,432 @@
+#ifndef PTL_OBJECT_POOL_PARTITIONED_HH
+#define PTL_OBJECT_POOL_PARTITIONED_HH
+
+#include <ptl/object_pool.hh>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+/*
+ * Partitioned Object Pool
+ * A partitioned pool has N lanes (sub pools); each lane has exactly
+ * one consumer.  push( key, object ) routes by the hash of the key,
+ * so all objects of one key (e.g. one account or session) are
+ * processed by the same consumer in push order: the per key state
+ * needs no lock and stays in the consumer's cache.
+ * The following behaviour is configurable with the help of the
+ * different policies:
+ * o rebalance::none / rebalance::buckets: if the keys can be moved
+ *   to another lane at runtime
+ * The life cycle (register_terminator / start / terminate) is the
+ * same as the one of object_pool::pool; it applies to all lanes.
+ */
+namespace ptl { namespace object_pool {
+
+namespace detail {
+
+// An object with the bucket of its key.
+template< typename OBJ_TYPE >
+class keyed {
+public:
+   keyed()
+      : bucket( 0 ) {
+   }
+
+   template< typename ... ARGS >
+   keyed( std::size_t const b, ARGS && ... args )
+      : bucket( b ),
+        value( std::forward< ARGS >( args ) ... ) {
+   }
+
+   std::size_t bucket;
+   OBJ_TYPE value;
+};
+
+}
+
+namespace policies {
+
+/*
+ * o rebalance::none / rebalance::buckets:
+ *   route( hash ) returns the bucket of a hash and its lane;
+ *   release( bucket ) is called when an object of the bucket was
+ *   processed.
+ *   none maps the hash directly to a lane: there are no costs, but
+ *   the mapping is fixed.
+ *   buckets maps the hash to one of BUCKETS_PER_LANE * lanes buckets
+ *   and each bucket to a lane.  It counts the objects per bucket
+ *   which are not yet processed; a bucket is only moved when it has
+ *   none - so the objects of a key are never processed by two
+ *   consumers at the same time.  This costs two atomic operations
+ *   per object.
+ */
+namespace rebalance {
+
+class none {
+public:
+   none( std::size_t const lanes )
+      : lanes_( lanes ) {
+   }
+
+   // Returns the bucket; lane is set.
+   std::size_t route( std::size_t const hash, std::size_t & lane ) {
+      lane = hash % lanes_;
+      return lane;
+   }
+
+   void release( std::size_t const ) {
+   }
+
+private:
+   std::size_t const lanes_;
+};
+
+template< std::size_t BUCKETS_PER_LANE >
+class basic_buckets {
+public:
+   static_assert( BUCKETS_PER_LANE >= 1,
+                  "each lane needs at least one bucket" );
+
+   basic_buckets( std::size_t const lanes )
+      : lanes_( lanes ),
+        buckets_( new bucket[ lanes * BUCKETS_PER_LANE ] ) {
+      for( std::size_t i( 0 ); i < lanes * BUCKETS_PER_LANE; ++i ) {
+         buckets_[ i ].lane.store( i % lanes, std::memory_order_relaxed );
+      }
+   }
+
+   std::size_t route( std::size_t const hash, std::size_t & lane ) {
+      std::size_t const b( hash % ( lanes_ * BUCKETS_PER_LANE ) );
+      bucket & s( buckets_[ b ] );
+      s.pushed.fetch_add( 1, std::memory_order_relaxed );
+      while( true ) {
+         // Either the mover sees the pending object or this sees
+         // that the bucket is moving.
+         s.pending.fetch_add( 1, std::memory_order_seq_cst );
+         lane = s.lane.load( std::memory_order_seq_cst );
+         if( lane != moving ) {
+            return b;
+         }
+         release( b );
+         std::unique_lock< std::mutex > lock( mutex_ );
+         moved_.wait( lock, [&s]() {
+               return s.lane.load( std::memory_order_seq_cst ) != moving; } );
+      }
+   }
+
+   // Either the mover sees that nothing is pending or this sees that
+   // the bucket is moving (and wakes up the mover).
+   void release( std::size_t const b ) {
+      bucket & s( buckets_[ b ] );
+      if( s.pending.fetch_sub( 1, std::memory_order_seq_cst ) == 1
+          and s.lane.load( std::memory_order_seq_cst ) == moving ) {
+         {
+            std::lock_guard< std::mutex > lock( mutex_ );
+         }
+         drained_.notify_all();
+      }
+   }
+
+   /*
+    * Moves the bucket to the given lane: waits until all its objects
+    * are processed; in the mean time pushes to the bucket wait.
+    * When this takes longer than max_wait (e.g. the consumer of the
+    * lane does not pop any more), the bucket stays in its lane and
+    * false is returned.  A lane consumer must not call this (or
+    * rebalance()) while it holds an unprocessed object: the move
+    * would wait for it until max_wait.
+    */
+   bool move_bucket( std::size_t const b, std::size_t const lane,
+                     std::chrono::nanoseconds const max_wait
+                        = default_max_wait ) {
+      std::lock_guard< std::mutex > guard( move_mutex_ );
+      return move_bucket_( b, lane, max_wait );
+   }
+
+   /*
+    * Moves one bucket from the lane which got the most objects since
+    * the last call to the one which got the least: the bucket whose
+    * load is closest to half of the difference.  Returns false when
+    * nothing was moved (also when the move took longer than
+    * max_wait - see move_bucket()).
+    */
+   bool rebalance( std::chrono::nanoseconds const max_wait
+                      = default_max_wait ) {
+      std::lock_guard< std::mutex > guard( move_mutex_ );
+      std::size_t const n( lanes_ * BUCKETS_PER_LANE );
+      std::vector< std::uint64_t > load( n );
+      std::vector< std::uint64_t > lane_load( lanes_ );
+      for( std::size_t b( 0 ); b < n; ++b ) {
+         load[ b ] = buckets_[ b ].pushed.exchange(
+            0, std::memory_order_relaxed );
+         lane_load[ lane_of( b ) ] += load[ b ];
+      }
+      std::size_t max_lane( 0 );
+      std::size_t min_lane( 0 );
+      for( std::size_t l( 1 ); l < lanes_; ++l ) {
+         if( lane_load[ l ] > lane_load[ max_lane ] ) {
+            max_lane = l;
+         }
+         if( lane_load[ l ] < lane_load[ min_lane ] ) {
+            min_lane = l;
+         }
+      }
+      std::uint64_t const half(
+         ( lane_load[ max_lane ] - lane_load[ min_lane ] ) / 2 );
+      std::size_t best( n );
+      for( std::size_t b( 0 ); b < n; ++b ) {
+         // Moving a bucket which is larger than the difference would
+         // only swap the roles of the lanes.
+         if( lane_of( b ) != max_lane or load[ b ] == 0
+             or load[ b ] >= 2 * half ) {
+            continue;
+         }
+         if( best == n or distance( load[ b ], half )
+             < distance( load[ best ], half ) ) {
+            best = b;
+         }
+      }
+      if( best == n ) {
+         return false;
+      }
+      return move_bucket_( best, min_lane, max_wait );
+   }
+
+   std::size_t buckets() const {
+      return lanes_ * BUCKETS_PER_LANE;
+   }
+
+private:
+   static std::size_t const moving = std::numeric_limits< std::size_t >::max();
+   static constexpr std::chrono::milliseconds default_max_wait{ 100 };
+
+   // Must be called with the move_mutex_ held.
+   bool move_bucket_( std::size_t const b, std::size_t const lane,
+                      std::chrono::nanoseconds const max_wait ) {
+      bucket & s( buckets_[ b ] );
+      std::size_t const old_lane( s.lane.load( std::memory_order_relaxed ) );
+      if( old_lane == lane ) {
+         return true;
+      }
+      std::chrono::steady_clock::time_point const deadline(
+         std::chrono::steady_clock::now() + max_wait );
+      s.lane.store( moving, std::memory_order_seq_cst );
+      bool moved( false );
+      {
+         std::unique_lock< std::mutex > lock( mutex_ );
+         moved = drained_.wait_until( lock, deadline, [&s]() {
+               return s.pending.load( std::memory_order_seq_cst ) == 0; } );
+         s.lane.store( moved ? lane : old_lane, std::memory_order_seq_cst );
+      }
+      moved_.notify_all();
+      return moved;
+   }
+
+   // Not valid while the bucket is moved.
+   std::size_t lane_of( std::size_t const b ) const {
+      return buckets_[ b ].lane.load( std::memory_order_acquire );
+   }
+
+   static std::uint64_t distance( std::uint64_t const a,
+                                  std::uint64_t const b ) {
+      return a > b ? a - b : b - a;
+   }
+
+   class bucket {
+   public:
+      bucket()
+         : pending( 0 ),
+           pushed( 0 ) {
+      }
+
+      std::atomic< std::size_t > lane;
+      // Pushed but not yet processed.
+      std::atomic< long > pending;
+      // Pushed since the last rebalance().
+      std::atomic< std::uint64_t > pushed;
+      char pad_[ detail::cache_line_size ];
+   };
+
+   std::size_t const lanes_;
+   std::unique_ptr< bucket[] > const buckets_;
+   std::mutex move_mutex_;
+   std::mutex mutex_;
+   // Signalled when a bucket was moved (or stays).
+   std::condition_variable moved_;
+   // Signalled when nothing is pending in a moving bucket.
+   std::condition_variable drained_;
+};
+
+template< std::size_t BUCKETS_PER_LANE >
+std::size_t const basic_buckets< BUCKETS_PER_LANE >::moving;
+
+template< std::size_t BUCKETS_PER_LANE >
+constexpr std::chrono::milliseconds
+basic_buckets< BUCKETS_PER_LANE >::default_max_wait;
+
+using buckets = basic_buckets< 16 >;
+
+}
+
+}
+
+/*
+ * LANE_POOL< T > is the pool type of each lane (e.g. an alias of
+ * object_pool::pool with all policies but the object type fixed).
+ */
+template< typename OBJ_TYPE,
+          typename KEY,
+          template< typename OBJ_TYPE_1 > class LANE_POOL,
+          typename POLICIY_REBALANCE = policies::rebalance::none,
+          typename HASH = std::hash< KEY > >
+class partitioned_pool {
+public:
+   using value_type = OBJ_TYPE;
+
+   // Each lane is constructed with the size handling (so this is
+   // the per lane capacity).
+   template< typename POLICIY_SIZE_HANDLING >
+   partitioned_pool( std::size_t const lanes,
+                     POLICIY_SIZE_HANDLING const & size_handling,
+                     HASH const & hash = HASH() )
+      : hash_( hash ),
+        rebalance_( lanes ),
+        lanes_( lanes ) {
+      if( lanes == 0 ) {
+         // Programming bug: at least one lane is needed.
+         abort();
+      }
+      for( std::size_t i( 0 ); i < lanes; ++i ) {
+         lanes_[ i ].pool.reset(
+            new LANE_POOL< detail::keyed< OBJ_TYPE > >( size_handling ) );
+      }
+   }
+
+   partitioned_pool( partitioned_pool const & ) = delete;
+   partitioned_pool & operator=( partitioned_pool const & ) = delete;
+
+   std::size_t lanes() const {
+      return lanes_.size();
+   }
+
+   void push( KEY const & key, OBJ_TYPE const & t ) {
+      emplace( key, t );
+   }
+
+   void push( KEY const & key, OBJ_TYPE && t ) {
+      emplace( key, std::move( t ) );
+   }
+
+   template< typename ... ARGS >
+   void emplace( KEY const & key, ARGS && ... args ) {
+      std::size_t lane( 0 );
+      std::size_t const b( rebalance_.route( hash_( key ), lane ) );
+      lanes_[ lane ].pool->emplace( b, std::forward< ARGS >( args ) ... );
+   }
+
+   /*
+    * Must only be called by the one consumer of the lane.  The
+    * previously popped object of the lane counts as processed when
+    * the consumer pops again.
+    */
+   OBJ_TYPE pop( std::size_t const lane ) {
+      pop_result< OBJ_TYPE > rval( pop_or_closed( lane ) );
+      if( not rval ) {
+         throw ptl::object_pool::terminate_except();
+      }
+      return std::move( *rval );
+   }
+
+   pop_result< OBJ_TYPE > pop_or_closed( std::size_t const lane ) {
+      lane_state & l( lanes_[ lane ] );
+      processed( lane );
+      pop_result< detail::keyed< OBJ_TYPE > > r( l.pool->pop_or_closed() );
+      if( not r ) {
+         return pop_result< OBJ_TYPE >( r.status() );
+      }
+      l.in_process = r->bucket;
+      l.busy = true;
+      return pop_result< OBJ_TYPE >( std::move( r->value ) );
+   }
+
+   // The consumer of the lane has processed the last popped object
+   // (before it pops the next one).
+   void processed( std::size_t const lane ) {
+      lane_state & l( lanes_[ lane ] );
+      if( l.busy ) {
+         rebalance_.release( l.in_process );
+         l.busy = false;
+      }
+   }
+
+   std::size_t size( std::size_t const lane ) {
+      return lanes_[ lane ].pool->size();
+   }
+
+   std::size_t size() {
+      std::size_t rval( 0 );
+      for( lane_state & l : lanes_ ) {
+         rval += l.pool->size();
+      }
+      return rval;
+   }
+
+   // Only with rebalance::buckets; see basic_buckets::rebalance().
+   bool rebalance() {
+      return rebalance_.rebalance();
+   }
+
+   bool rebalance( std::chrono::nanoseconds const max_wait ) {
+      return rebalance_.rebalance( max_wait );
+   }
+
+   void start() {
+      for( lane_state & l : lanes_ ) {
+         l.pool->start();
+      }
+   }
+
+   void terminate() {
+      for( lane_state & l : lanes_ ) {
+         l.pool->terminate();
+      }
+   }
+
+   void register_terminator() {
+      for( lane_state & l : lanes_ ) {
+         l.pool->register_terminator();
+      }
+   }
+
+private:
+   class lane_state {
+   public:
+      lane_state()
+         : in_process( 0 ),
+           busy( false ) {
+      }
+
+      std::unique_ptr< LANE_POOL< detail::keyed< OBJ_TYPE > > > pool;
+      // Only used by the consumer of the lane.
+      std::size_t in_process;
+      bool busy;
+      char pad_[ detail::cache_line_size ];
+   };
+
+   HASH const hash_;
+   POLICIY_REBALANCE rebalance_;
+   std::vector< lane_state > lanes_;
+};
+
+}}
+
+#endif
@@ -0,0 +1,416 @@
+#ifndef PTL_OBJECT_POOL_RECYCLING_HH
+#define PTL_OBJECT_POOL_RECYCLING_HH
+
+#include <ptl/object_pool.hh>
+
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+ * Recycling Object Pool
+ * In contrast to object_pool::pool (which passes objects from
+ * producers to consumers) the recycling pool keeps idle objects
+ * which are expensive to create (e.g. large buffers) for reuse.
+ * acquire() returns a handle which gives the object back to the
+ * pool when it is destroyed.  The pool must outlive all handles.
+ * The following behaviour is configurable with the help of the
+ * different policies:
+ * o factory::default_construct: how new objects are created
+ * o reset::none / reset::clear: what is done with an object when
+ *   it is given back
+ * o cache::none / cache::magazines: how the idle objects are cached
+ *   in front of the shared depot
+ */
+namespace ptl { namespace object_pool {
+
+namespace detail {
+
+/*
+ * Shared stock of idle objects behind one mutex.  At most max_idle
+ * objects are kept; the others are deleted (outside the lock).
+ */
+template< typename OBJ_TYPE >
+class depot {
+public:
+   using object_ptr = std::unique_ptr< OBJ_TYPE >;
+
+   depot( std::size_t const max_idle )
+      : max_idle_( max_idle ) {
+   }
+
+   depot( depot const & ) = delete;
+   depot & operator=( depot const & ) = delete;
+
+   object_ptr get() {
+      std::unique_lock< std::mutex > lock( mutex_ );
+      if( idle_.empty() ) {
+         return object_ptr();
+      }
+      object_ptr rval( std::move( idle_.back() ) );
+      idle_.pop_back();
+      return rval;
+   }
+
+   void put( object_ptr && p ) {
+      {
+         std::unique_lock< std::mutex > lock( mutex_ );
+         if( idle_.size() < max_idle_ ) {
+            idle_.push_back( std::move( p ) );
+            return;
+         }
+      }
+      p.reset();
+   }
+
+   // Moves up to n objects to the end of out.
+   void take( std::vector< object_ptr > & out, std::size_t n ) {
+      std::unique_lock< std::mutex > lock( mutex_ );
+      while( n > 0 and not idle_.empty() ) {
+         out.push_back( std::move( idle_.back() ) );
+         idle_.pop_back();
+         --n;
+      }
+   }
+
+   // Moves objects from the end of in until keep objects are left.
+   void give( std::vector< object_ptr > & in, std::size_t const keep ) {
+      std::vector< object_ptr > surplus;
+      {
+         std::unique_lock< std::mutex > lock( mutex_ );
+         while( in.size() > keep ) {
+            if( idle_.size() < max_idle_ ) {
+               idle_.push_back( std::move( in.back() ) );
+            } else {
+               surplus.push_back( std::move( in.back() ) );
+            }
+            in.pop_back();
+         }
+      }
+   }
+
+   std::size_t size() {
+      std::unique_lock< std::mutex > lock( mutex_ );
+      return idle_.size();
+   }
+
+private:
+   std::size_t const max_idle_;
+   std::mutex mutex_;
+   std::vector< object_ptr > idle_;
+};
+
+}
+
+namespace policies {
+
+/*
+ * o factory::default_construct:
+ *   Creates new objects when no idle one is available.  create()
+ *   might be called concurrently from different threads.
+ */
+namespace factory {
+
+template< typename OBJ_TYPE >
+class default_construct {
+public:
+   std::unique_ptr< OBJ_TYPE > create() const {
+      return std::unique_ptr< OBJ_TYPE >( new OBJ_TYPE() );
+   }
+};
+
+}
+
+/*
+ * o reset::none / reset::clear:
+ *   Called with the object when it is given back to the pool -
+ *   before another thread can acquire it.  clear calls the clear()
+ *   member function (e.g. of a std::vector used as buffer; this
+ *   keeps the allocated memory).
+ */
+namespace reset {
+
+class none {
+public:
+   template< typename OBJ_TYPE >
+   void operator()( OBJ_TYPE & ) const {
+   }
+};
+
+class clear {
+public:
+   template< typename OBJ_TYPE >
+   void operator()( OBJ_TYPE & t ) const {
+      t.clear();
+   }
+};
+
+}
+
+/*
+ * o cache::none / cache::magazines:
+ *   none always uses the depot (one mutex for all threads).
+ *   magazines puts a small stock of objects (a magazine) per
+ *   thread in front of the depot: acquire and release only use the
+ *   magazine of the calling thread; only when this is empty / full,
+ *   half a magazine is moved from / to the depot at once.
+ *   The magazines are indexed by the thread index (there is one
+ *   per hardware thread), so each is mostly used by one thread and
+ *   its mutex is normally not contended.
+ *   reserved( max_idle ) is the part of max_idle which the cache
+ *   keeps itself: the depot only keeps the rest, so the pool never
+ *   keeps more than max_idle idle objects.  A magazine keeps at
+ *   most MAGAZINE_SIZE objects - and less when max_idle is small
+ *   compared to the number of magazines (at least half of max_idle
+ *   stays in the depot); with less than two objects per magazine
+ *   the magazines are not used at all.
+ */
+namespace cache {
+
+template< typename OBJ_TYPE >
+class none {
+public:
+   using object_ptr = std::unique_ptr< OBJ_TYPE >;
+
+   static std::size_t reserved( std::size_t const /* max_idle */ ) {
+      return 0;
+   }
+
+   none( detail::depot< OBJ_TYPE > & depot,
+         std::size_t const /* max_idle */ )
+      : depot_( depot ) {
+   }
+
+   object_ptr get() {
+      return depot_.get();
+   }
+
+   void put( object_ptr && p ) {
+      depot_.put( std::move( p ) );
+   }
+
+   std::size_t size() const {
+      return 0;
+   }
+
+private:
+   detail::depot< OBJ_TYPE > & depot_;
+};
+
+template< typename OBJ_TYPE, std::size_t MAGAZINE_SIZE >
+class basic_magazines {
+public:
+   static_assert( MAGAZINE_SIZE >= 2,
+                  "a magazine needs at least two objects" );
+
+   using object_ptr = std::unique_ptr< OBJ_TYPE >;
+
+   static std::size_t reserved( std::size_t const max_idle ) {
+      return count() * capacity( max_idle );
+   }
+
+   basic_magazines( detail::depot< OBJ_TYPE > & depot,
+                    std::size_t const max_idle )
+      : depot_( depot ),
+        count_( count() ),
+        capacity_( capacity( max_idle ) ),
+        magazines_( new magazine[ count_ ] ) {
+   }
+
+   object_ptr get() {
+      if( capacity_ == 0 ) {
+         return depot_.get();
+      }
+      magazine & m( local() );
+      std::unique_lock< std::mutex > lock( m.mutex );
+      if( m.objects.empty() ) {
+         depot_.take( m.objects, capacity_ / 2 );
+         if( m.objects.empty() ) {
+            return object_ptr();
+         }
+      }
+      object_ptr rval( std::move( m.objects.back() ) );
+      m.objects.pop_back();
+      return rval;
+   }
+
+   void put( object_ptr && p ) {
+      if( capacity_ == 0 ) {
+         depot_.put( std::move( p ) );
+         return;
+      }
+      magazine & m( local() );
+      std::unique_lock< std::mutex > lock( m.mutex );
+      if( m.objects.size() >= capacity_ ) {
+         depot_.give( m.objects, capacity_ / 2 );
+      }
+      m.objects.push_back( std::move( p ) );
+   }
+
+   // Only a snapshot when used concurrently.
+   std::size_t size() const {
+      std::size_t rval( 0 );
+      for( std::size_t i( 0 ); i < count_; ++i ) {
+         std::unique_lock< std::mutex > lock( magazines_[ i ].mutex );
+         rval += magazines_[ i ].objects.size();
+      }
+      return rval;
+   }
+
+private:
+   class magazine {
+   public:
+      std::mutex mutex;
+      std::vector< object_ptr > objects;
+      char pad_[ detail::cache_line_size ];
+   };
+
+   magazine & local() {
+      return magazines_[ detail::thread_index() % count_ ];
+   }
+
+   static std::size_t count() {
+      return std::max( std::thread::hardware_concurrency(), 1U );
+   }
+
+   // The objects per magazine: 0 when the magazines are not used.
+   static std::size_t capacity( std::size_t const max_idle ) {
+      std::size_t const c(
+         std::min( MAGAZINE_SIZE, max_idle / ( 2 * count() ) ) );
+      return c >= 2 ? c : 0;
+   }
+
+   detail::depot< OBJ_TYPE > & depot_;
+   std::size_t const count_;
+   std::size_t const capacity_;
+   std::unique_ptr< magazine[] > const magazines_;
+};
+
+template< typename OBJ_TYPE >
+using magazines = basic_magazines< OBJ_TYPE, 32 >;
+
+}
+
+}
+
+template< typename OBJ_TYPE,
+          typename POLICIY_FACTORY =
+             policies::factory::default_construct< OBJ_TYPE >,
+          typename POLICIY_RESET = policies::reset::none,
+          template< typename OBJ_TYPE_1 >
+             class POLICIY_CACHE = policies::cache::magazines >
+class recycling_pool {
+public:
+   using value_type = OBJ_TYPE;
+
+   /*
+    * Owns an acquired object and gives it back to the pool when it
+    * is destroyed (or reset).
+    */
+   class handle {
+   public:
+      handle()
+         : pool_( nullptr ) {
+      }
+
+      handle( handle && other )
+         : pool_( other.pool_ ),
+           object_( std::move( other.object_ ) ) {
+      }
+
+      handle & operator=( handle && other ) {
+         reset();
+         pool_ = other.pool_;
+         object_ = std::move( other.object_ );
+         return *this;
+      }
+
+      ~handle() {
+         reset();
+      }
+
+      handle( handle const & ) = delete;
+      handle & operator=( handle const & ) = delete;
+
+      // Gives the object back to the pool now.
+      void reset() {
+         if( object_ ) {
+            pool_->release_( std::move( object_ ) );
+         }
+      }
+
+      OBJ_TYPE * get() const {
+         return object_.get();
+      }
+
+      OBJ_TYPE & operator*() const {
+         return *object_;
+      }
+
+      OBJ_TYPE * operator->() const {
+         return object_.get();
+      }
+
+      explicit operator bool() const {
+         return static_cast< bool >( object_ );
+      }
+
+   private:
+      handle( recycling_pool * const pool,
+              std::unique_ptr< OBJ_TYPE > && object )
+         : pool_( pool ),
+           object_( std::move( object ) ) {
+      }
+
+      recycling_pool * pool_;
+      std::unique_ptr< OBJ_TYPE > object_;
+
+      friend class recycling_pool;
+   };
+
+   // At most max_idle objects are kept (in the cache and the depot
+   // together).
+   recycling_pool( std::size_t const max_idle,
+                   POLICIY_FACTORY const & factory = POLICIY_FACTORY(),
+                   POLICIY_RESET const & reset = POLICIY_RESET() )
+      : depot_( max_idle - POLICIY_CACHE< OBJ_TYPE >::reserved( max_idle ) ),
+        cache_( depot_, max_idle ),
+        factory_( factory ),
+        reset_( reset ) {
+   }
+
+   recycling_pool( recycling_pool const & ) = delete;
+   recycling_pool & operator=( recycling_pool const & ) = delete;
+
+   // Returns an idle object - or a new one when there is none.
+   handle acquire() {
+      std::unique_ptr< OBJ_TYPE > p( cache_.get() );
+      if( not p ) {
+         p = factory_.create();
+      }
+      return handle( this, std::move( p ) );
+   }
+
+   // The number of idle objects.  Only a snapshot when used
+   // concurrently.
+   std::size_t idle() {
+      return cache_.size() + depot_.size();
+   }
+
+private:
+   void release_( std::unique_ptr< OBJ_TYPE > && p ) {
+      reset_( *p );
+      cache_.put( std::move( p ) );
+   }
+
+   // The cache refers to the depot: must be destroyed first.
+   detail::depot< OBJ_TYPE > depot_;
+   POLICIY_CACHE< OBJ_TYPE > cache_;
+   POLICIY_FACTORY const factory_;
+   POLICIY_RESET const reset_;
+};
+
+}}
+
+#endif
@@ -0,0 +1,312 @@
+#ifndef PTL_OBJECT_POOL_SELECT_HH
+#define PTL_OBJECT_POOL_SELECT_HH
+
+#include <ptl/object_pool.hh>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+/*
+ * Select
+ * Waits for several pools at once: selector::wait() blocks until one
+ * of the added pools has an object (or is terminated) and returns
+ * its index; the caller then pops from this pool with try_pop().
+ * (As other consumers might have been faster, try_pop() can return
+ * empty: then just wait again.)
+ * The pools must use notify::selectable as not empty notify policy:
+ * it signals all attached selectors' wakeup when objects are pushed.
+ * So there is no polling; the pools can have different types.
+ *
+ * Usage:
+ *    selector s;
+ *    std::size_t const control( s.add( control_pool ) );
+ *    std::size_t const data( s.add( data_pool ) );
+ *    while( true ) {
+ *       std::size_t const i( s.wait_for( std::chrono::seconds( 1 ) ) );
+ *       if( i == control ) { ... control_pool.try_pop() ... }
+ *       ...
+ *    }
+ */
+namespace ptl { namespace object_pool {
+
+namespace detail {
+
+/*
+ * Event count: a waiter reads the epoch, checks its condition and
+ * only sleeps when the epoch is still the same.  signal() only takes
+ * the mutex when somebody waits.
+ */
+class wakeup {
+public:
+   wakeup()
+      : epoch_( 0 ),
+        waiters_( 0 ) {
+   }
+
+   wakeup( wakeup const & ) = delete;
+   wakeup & operator=( wakeup const & ) = delete;
+
+   std::uint64_t epoch() const {
+      return epoch_.load( std::memory_order_seq_cst );
+   }
+
+   void signal() {
+      epoch_.fetch_add( 1, std::memory_order_seq_cst );
+      if( waiters_.load( std::memory_order_seq_cst ) != 0 ) {
+         std::lock_guard< std::mutex > guard( mutex_ );
+         cv_.notify_all();
+      }
+   }
+
+   // Returns false when the deadline was reached before the epoch
+   // changed.
+   template< typename CLOCK, typename DURATION >
+   bool wait_until(
+      std::uint64_t const epoch,
+      std::chrono::time_point< CLOCK, DURATION > const & deadline ) {
+      std::unique_lock< std::mutex > guard( mutex_ );
+      waiters_.fetch_add( 1, std::memory_order_seq_cst );
+      bool const rval(
+         cv_.wait_until( guard, deadline,
+                         [this, epoch]() { return this->epoch() != epoch; } ) );
+      waiters_.fetch_sub( 1, std::memory_order_relaxed );
+      return rval;
+   }
+
+   void wait( std::uint64_t const epoch ) {
+      std::unique_lock< std::mutex > guard( mutex_ );
+      waiters_.fetch_add( 1, std::memory_order_seq_cst );
+      cv_.wait( guard, [this, epoch]() { return this->epoch() != epoch; } );
+      waiters_.fetch_sub( 1, std::memory_order_relaxed );
+   }
+
+private:
+   std::atomic< std::uint64_t > epoch_;
+   std::atomic< long > waiters_;
+   std::mutex mutex_;
+   std::condition_variable cv_;
+};
+
+}
+
+namespace policies {
+
+namespace notify {
+
+/*
+ * Like notify::one - and additionally signals the attached wakeups
+ * (of selectors).  As long as nothing is attached this only costs
+ * one atomic load per notification.
+ */
+template< typename POLICIY_THREADING >
+class selectable
+   : public one< POLICIY_THREADING > {
+public:
+   selectable()
+      : attached_( 0 ) {
+   }
+
+   void notify() {
+      one< POLICIY_THREADING >::notify();
+      signal();
+   }
+
+   void notify( std::size_t const n ) {
+      one< POLICIY_THREADING >::notify( n );
+      if( n != 0 ) {
+         signal();
+      }
+   }
+
+   void notify_all() {
+      one< POLICIY_THREADING >::notify_all();
+      signal();
+   }
+
+   // The selector checks if the pool is ready after this: the fence
+   // pairs with the one of signal().
+   void attach( detail::wakeup & w ) {
+      std::lock_guard< std::mutex > guard( wakeups_mutex_ );
+      wakeups_.push_back( &w );
+      attached_.store( wakeups_.size(), std::memory_order_seq_cst );
+      std::atomic_thread_fence( std::memory_order_seq_cst );
+   }
+
+   void detach( detail::wakeup & w ) {
+      std::lock_guard< std::mutex > guard( wakeups_mutex_ );
+      wakeups_.erase( std::remove( wakeups_.begin(), wakeups_.end(), &w ),
+                      wakeups_.end() );
+      attached_.store( wakeups_.size(), std::memory_order_seq_cst );
+   }
+
+private:
+   // The fence (between the push and the load of attached_) pairs
+   // with the one of attach() (between the store of attached_ and
+   // the readiness check): either the selector sees the pushed
+   // object or this sees the wakeup.
+   void signal() {
+      std::atomic_thread_fence( std::memory_order_seq_cst );
+      if( attached_.load( std::memory_order_relaxed ) == 0 ) {
+         return;
+      }
+      std::lock_guard< std::mutex > guard( wakeups_mutex_ );
+      for( detail::wakeup * const w : wakeups_ ) {
+         w->signal();
+      }
+   }
+
+   std::atomic< std::size_t > attached_;
+   std::mutex wakeups_mutex_;
+   std::vector< detail::wakeup * > wakeups_;
+};
+
+}
+
+}
+
+/*
+ * o select_order::priority: when several pools are ready, the one
+ *   which was added first is returned.
+ * o select_order::round_robin: the ready pools are returned in turn.
+ */
+enum class select_order {
+   priority,
+   round_robin
+};
+
+// Returned by selector::wait_for() / wait_until() when the deadline
+// was reached.
+std::size_t const select_timeout( static_cast< std::size_t >( -1 ) );
+
+/*
+ * Used by one (consumer) thread.  The pools must outlive the
+ * selector (or be removed before).
+ */
+class selector {
+public:
+   selector( select_order const order = select_order::priority )
+      : order_( order ),
+        next_( 0 ) {
+   }
+
+   ~selector() {
+      for( std::size_t i( 0 ); i < pools_.size(); ++i ) {
+         remove( i );
+      }
+   }
+
+   selector( selector const & ) = delete;
+   selector & operator=( selector const & ) = delete;
+
+   // Returns the index of the pool.
+   template< typename POOL >
+   std::size_t add( POOL & pool ) {
+      pool.attach( wakeup_ );
+      pools_.emplace_back(
+         [&pool]() { return pool.size() != 0 or pool.should_terminate(); },
+         [&pool]( detail::wakeup & w ) { pool.detach( w ); } );
+      return pools_.size() - 1;
+   }
+
+   // The pool is not reported any more (e.g. as it is drained).
+   void remove( std::size_t const index ) {
+      entry & e( pools_.at( index ) );
+      if( e.active ) {
+         e.detach( wakeup_ );
+         e.active = false;
+      }
+   }
+
+   /*
+    * Returns the index of a pool which has an object - or which is
+    * terminated (so that try_pop() returns the objects which are
+    * left and then pop_status::closed).
+    */
+   std::size_t wait() {
+      while( true ) {
+         std::uint64_t const epoch( wakeup_.epoch() );
+         std::size_t const rval( ready() );
+         if( rval != select_timeout ) {
+            return rval;
+         }
+         wakeup_.wait( epoch );
+      }
+   }
+
+   template< typename REP, typename PERIOD >
+   std::size_t wait_for( std::chrono::duration< REP, PERIOD > const & d ) {
+      return wait_until( std::chrono::steady_clock::now() + d );
+   }
+
+   template< typename CLOCK, typename DURATION >
+   std::size_t wait_until(
+      std::chrono::time_point< CLOCK, DURATION > const & deadline ) {
+      while( true ) {
+         std::uint64_t const epoch( wakeup_.epoch() );
+         std::size_t const rval( ready() );
+         if( rval != select_timeout ) {
+            return rval;
+         }
+         if( not wakeup_.wait_until( epoch, deadline ) ) {
+            return ready();
+         }
+      }
+   }
+
+private:
+   class entry {
+   public:
+      entry( std::function< bool () > const & r,
+             std::function< void ( detail::wakeup & ) > const & d )
+         : ready( r ),
+           detach( d ),
+           active( true ) {
+      }
+
+      std::function< bool () > ready;
+      std::function< void ( detail::wakeup & ) > detach;
+      bool active;
+   };
+
+   // The first ready pool in the configured order - or select_timeout.
+   std::size_t ready() {
+      std::size_t const n( pools_.size() );
+      bool any_active( false );
+      for( std::size_t i( 0 ); i < n; ++i ) {
+         std::size_t const index( ( next_ + i ) % n );
+         entry & e( pools_[ index ] );
+         if( not e.active ) {
+            continue;
+         }
+         any_active = true;
+         if( e.ready() ) {
+            if( order_ == select_order::round_robin ) {
+               next_ = index + 1;
+            }
+            return index;
+         }
+      }
+      if( not any_active ) {
+         // Programming bug: this would wait forever.
+         abort();
+      }
+      return select_timeout;
+   }
+
+   select_order const order_;
+   // Where the search starts (always 0 for priority).
+   std::size_t next_;
+   detail::wakeup wakeup_;
+   std::vector< entry > pools_;
+};
+
+}}
+
+#endif
@@ -0,0 +1,225 @@
+#ifndef PTL_OBJECT_POOL_SHARDED_HH
+#define PTL_OBJECT_POOL_SHARDED_HH
+
+#include <ptl/object_pool.hh>
+
+#include <memory>
+#include <vector>
+
+/*
+ * Sharded Object Pool
+ * A sharded pool keeps N sub pools (shards) - typically one per
+ * worker / core.  Producers push to their local shard, consumers pop
+ * from their local shard and steal from the other shards when their
+ * own one is empty.  So (as long as the work is balanced) each
+ * shard is mostly used by one thread.
+ * The shards are object_pool::pool instances (POOL) of which only
+ * the non blocking functions are used: blocking is done by the
+ * sharded pool itself with one wakeup for all shards.  Therefore the
+ * notify policies of POOL should be cheap when nobody waits
+ * (e.g. notify::one).
+ * The life cycle (register_terminator / start / terminate) is the
+ * same as the one of object_pool::pool.
+ */
+namespace ptl { namespace object_pool {
+
+template< typename POOL >
+class sharded_pool {
+public:
+   using value_type = typename POOL::value_type;
+
+   template< typename POLICIY_SIZE_HANDLING >
+   sharded_pool( std::size_t const shards,
+                 POLICIY_SIZE_HANDLING const & size_handling ) {
+      if( shards == 0 ) {
+         // Programming bug: at least one shard is needed.
+         abort();
+      }
+      for( std::size_t i( 0 ); i < shards; ++i ) {
+         shards_.emplace_back( new POOL( size_handling ) );
+      }
+   }
+
+   sharded_pool( sharded_pool const & ) = delete;
+   sharded_pool & operator=( sharded_pool const & ) = delete;
+
+   std::size_t shards() const {
+      return shards_.size();
+   }
+
+   // The shard of the calling thread: the threads are distributed
+   // round robin over the shards.
+   std::size_t local_shard() const {
+      return detail::thread_index() % shards_.size();
+   }
+
+   void push( value_type const & t ) {
+      emplace_at( local_shard(), t );
+   }
+
+   void push( value_type && t ) {
+      emplace_at( local_shard(), std::move( t ) );
+   }
+
+   void push_at( std::size_t const shard, value_type const & t ) {
+      emplace_at( shard, t );
+   }
+
+   void push_at( std::size_t const shard, value_type && t ) {
+      emplace_at( shard, std::move( t ) );
+   }
+
+   /*
+    * Pushes to the given shard.  When this is full, the object is
+    * put into any other shard with a free slot - and only when all
+    * are full, the producer waits.
+    */
+   template< typename ... ARGS >
+   void emplace_at( std::size_t const shard, ARGS && ... args ) {
+      policies::threading::lock_free::lock lock( threading_ );
+      if( termination_.should_terminate() ) {
+         // Try to push something in a termianted pool
+         // -> implementation bug of non library source code.
+         abort();
+      }
+
+      while( not try_emplace_all(
+                shard, std::forward< ARGS >( args ) ... ) ) {
+         notify_not_full_.wait(
+            lock, [this]() { return any_free_slot(); } );
+      }
+      notify_not_empty_.notify();
+   }
+
+   value_type pop() {
+      return pop_at( local_shard() );
+   }
+
+   value_type pop_at( std::size_t const shard ) {
+      pop_result< value_type > rval( pop_or_closed_at( shard ) );
+      if( not rval ) {
+         throw ptl::object_pool::terminate_except();
+      }
+      return std::move( *rval );
+   }
+
+   pop_result< value_type > pop_or_closed() {
+      return pop_or_closed_at( local_shard() );
+   }
+
+   /*
+    * Pops from the given shard - or steals from the other shards
+    * when this one is empty.
+    */
+   pop_result< value_type > pop_or_closed_at( std::size_t const shard ) {
+      policies::threading::lock_free::lock lock( threading_ );
+
+      while( true ) {
+         pop_result< value_type > rval( try_pop_all( shard ) );
+         if( rval ) {
+            return rval;
+         }
+
+         if( termination_.should_terminate() ) {
+            // All pushes happened before the termination: so when
+            // this also fails, the pool is really drained.
+            pop_result< value_type > last( try_pop_all( shard ) );
+            if( last ) {
+               return last;
+            }
+            return pop_result< value_type >( pop_status::closed );
+         }
+
+         notify_not_empty_.wait(
+            lock, [this]() {
+               return termination_.should_terminate() or any_object(); } );
+      }
+   }
+
+   std::size_t size() {
+      std::size_t rval( 0 );
+      for( auto & s : shards_ ) {
+         rval += s->size();
+      }
+      return rval;
+   }
+
+   void start() {
+      policies::threading::lock_free::lifecycle_lock lock( threading_ );
+      termination_.start();
+   }
+
+   void terminate() {
+      {
+         policies::threading::lock_free::lifecycle_lock lock( threading_ );
+         termination_.terminate( lock );
+      }
+      notify_not_full_.notify_all();
+      notify_not_empty_.notify_all();
+   }
+
+   void register_terminator() {
+      policies::threading::lock_free::lifecycle_lock lock( threading_ );
+      termination_.register_terminator();
+   }
+
+   bool should_terminate() {
+      return termination_.should_terminate();
+   }
+
+private:
+   template< typename ... ARGS >
+   bool try_emplace_all( std::size_t const shard, ARGS && ... args ) {
+      std::size_t const n( shards_.size() );
+      for( std::size_t i( 0 ); i < n; ++i ) {
+         if( shards_[ ( shard + i ) % n ]->try_emplace(
+                std::forward< ARGS >( args ) ... ) ) {
+            return true;
+         }
+      }
+      return false;
+   }
+
+   pop_result< value_type > try_pop_all( std::size_t const shard ) {
+      std::size_t const n( shards_.size() );
+      for( std::size_t i( 0 ); i < n; ++i ) {
+         pop_result< value_type > rval(
+            shards_[ ( shard + i ) % n ]->try_pop() );
+         if( rval ) {
+            notify_not_full_.notify();
+            return rval;
+         }
+      }
+      return pop_result< value_type >( pop_status::empty );
+   }
+
+   bool any_free_slot() {
+      for( auto & s : shards_ ) {
+         if( not s->full() ) {
+            return true;
+         }
+      }
+      return false;
+   }
+
+   bool any_object() {
+      for( auto & s : shards_ ) {
+         if( s->size() != 0 ) {
+            return true;
+         }
+      }
+      return false;
+   }
+
+   std::vector< std::unique_ptr< POOL > > shards_;
+
+   policies::threading::lock_free threading_;
+   policies::termination::terminatable<
+      policies::threading::lock_free > termination_;
+   policies::notify::one< policies::threading::lock_free > notify_not_full_;
+   policies::notify::one< policies::threading::lock_free > notify_not_empty_;
+};
+
+}}
+
+#endif
@@ -0,0 +1,578 @@
+#ifndef PTL_OBJECT_POOL_SHM_HH
+#define PTL_OBJECT_POOL_SHM_HH
+
+#include <ptl/object_pool.hh>
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <climits>
+#include <cstdint>
+#include <cstdlib>
+#include <ctime>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <type_traits>
+
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+/*
+ * Inter process Object Pool
+ * Policies which place the pool state into a POSIX shared memory
+ * segment, so that producers and consumers can be different
+ * processes:
+ * o threading::process_shared: owns the mapping of the segment;
+ *   one process creates it (mode::create) and the others open it
+ *   (mode::open) after it was created.
+ * o container::shm_ring: bounded lock free ring of trivially
+ *   copyable objects in the segment.
+ * o notify::futex: waits with the help of futexes in the segment.
+ * o termination::terminatable< threading::process_shared >: the
+ *   termination state lives in the segment.
+ * The pool must be constructed with the name and the mode which are
+ * passed to the threading policy:
+ *    pool< int, threading::process_shared, notify::futex,
+ *          notify::futex, termination::terminatable,
+ *          container::shm_ring, size_handling::constant >
+ *       p( size_handling::constant( 1024 ), "/name",
+ *          threading::process_shared::mode::create );
+ * All processes must use the same OBJ_TYPE and size.  This is Linux
+ * specific (futex).
+ */
+namespace ptl { namespace object_pool {
+
+namespace detail {
+
+inline void futex_wait( std::atomic< std::uint32_t > & word,
+                        std::uint32_t const expected,
+                        struct timespec const * const timeout ) {
+   syscall( SYS_futex, reinterpret_cast< std::uint32_t * >( &word ),
+            FUTEX_WAIT, expected, timeout, nullptr, 0 );
+}
+
+inline void futex_wake( std::atomic< std::uint32_t > & word, int const n ) {
+   syscall( SYS_futex, reinterpret_cast< std::uint32_t * >( &word ),
+            FUTEX_WAKE, n, nullptr, nullptr, 0 );
+}
+
+// Set when a part of the segment is initialized.
+std::uint32_t const shm_ready_magic( 0x50544c31 );
+
+/*
+ * Waiters read the epoch, count themselves and only sleep when the
+ * epoch did not change; notifiers change the epoch and only call
+ * into the kernel when somebody waits.
+ */
+class futex_event {
+public:
+   std::atomic< std::uint32_t > epoch;
+   std::atomic< std::uint32_t > waiters;
+   char pad_[ cache_line_size ];
+};
+
+// The first page of the segment.
+class shm_header {
+public:
+   std::atomic< std::uint32_t > ready;
+   std::atomic< std::uint32_t > started;
+   std::atomic< std::int64_t > terminate_cnt;
+   char pad_[ cache_line_size ];
+   futex_event events[ 2 ];
+};
+
+static_assert( ATOMIC_INT_LOCK_FREE == 2 and ATOMIC_LLONG_LOCK_FREE == 2,
+               "process shared atomics must be lock free" );
+
+}
+
+namespace policies {
+
+namespace threading {
+
+/*
+ * The data path does not lock (the container is lock free); the
+ * termination state is atomic.  So there is nothing to lock at all.
+ */
+class process_shared {
+public:
+   using locks_container = std::false_type;
+
+   enum class mode {
+      create,
+      open
+   };
+
+   class lock {
+   public:
+      lock( process_shared & ) {}
+
+      bool contended() const { return false; }
+      void unlock() {}
+      void relock() {}
+   };
+
+   using lifecycle_lock = lock;
+
+   // Throws std::system_error when the segment cannot be created /
+   // opened.
+   process_shared( std::string const & name, mode const m )
+      : name_( name ),
+        mode_( m ),
+        page_size_( static_cast< std::size_t >( sysconf( _SC_PAGESIZE ) ) ),
+        fd_( shm_open( name.c_str(),
+                       m == mode::create ? O_RDWR | O_CREAT | O_EXCL
+                                         : O_RDWR,
+                       0600 ) ),
+        header_( nullptr ),
+        next_event_( 0 ) {
+      if( fd_ < 0 ) {
+         throw std::system_error( errno, std::system_category(),
+                                  "shm_open " + name );
+      }
+      // The destructor does not run when this throws: the segment
+      // must not stay open (and created segments not linked).
+      try {
+         if( mode_ == mode::create ) {
+            if( ftruncate( fd_, static_cast< off_t >( page_size_ ) )
+                != 0 ) {
+               throw std::system_error( errno, std::system_category(),
+                                        "ftruncate " + name );
+            }
+         } else {
+            wait_for_size( page_size_ );
+         }
+         header_ = static_cast< detail::shm_header * >(
+            map( 0, page_size_ ) );
+      } catch( ... ) {
+         close();
+         throw;
+      }
+      if( mode_ == mode::create ) {
+         // The memory is zeroed: only the flag must be set.
+         header_->ready.store( detail::shm_ready_magic,
+                               std::memory_order_release );
+      } else {
+         while( header_->ready.load( std::memory_order_acquire )
+                != detail::shm_ready_magic ) {
+            std::this_thread::yield();
+         }
+      }
+   }
+
+   ~process_shared() {
+      munmap( header_, page_size_ );
+      close();
+   }
+
+   process_shared( process_shared const & ) = delete;
+   process_shared & operator=( process_shared const & ) = delete;
+
+   bool creator() const {
+      return mode_ == mode::create;
+   }
+
+   detail::shm_header & header() {
+      return *header_;
+   }
+
+   // Each notify policy of the pool gets its own event; as the
+   // pools are constructed in the same way in all processes, they
+   // get the same ones.
+   detail::futex_event & next_event() {
+      if( next_event_ >= 2 ) {
+         // Programming bug: only not_full and not_empty are known.
+         abort();
+      }
+      return header_->events[ next_event_++ ];
+   }
+
+   // Maps the container part of the segment (after the header).
+   void * map_container( std::size_t const bytes ) {
+      if( mode_ == mode::create ) {
+         if( ftruncate( fd_, static_cast< off_t >( page_size_ + bytes ) )
+             != 0 ) {
+            throw std::system_error( errno, std::system_category(),
+                                     "ftruncate " + name_ );
+         }
+      } else {
+         wait_for_size( page_size_ + bytes );
+      }
+      return map( page_size_, bytes );
+   }
+
+   void unmap_container( void * const p, std::size_t const bytes ) {
+      munmap( p, bytes );
+   }
+
+private:
+   void * map( std::size_t const offset, std::size_t const bytes ) {
+      void * const p( mmap( nullptr, bytes, PROT_READ | PROT_WRITE,
+                            MAP_SHARED, fd_,
+                            static_cast< off_t >( offset ) ) );
+      if( p == MAP_FAILED ) {
+         throw std::system_error( errno, std::system_category(),
+                                  "mmap " + name_ );
+      }
+      return p;
+   }
+
+   // The creating process might not yet have set the size.
+   void wait_for_size( std::size_t const bytes ) {
+      while( true ) {
+         struct stat st;
+         if( fstat( fd_, &st ) != 0 ) {
+            throw std::system_error( errno, std::system_category(),
+                                     "fstat " + name_ );
+         }
+         if( static_cast< std::size_t >( st.st_size ) >= bytes ) {
+            return;
+         }
+         std::this_thread::yield();
+      }
+   }
+
+   void close() {
+      ::close( fd_ );
+      if( mode_ == mode::create ) {
+         shm_unlink( name_.c_str() );
+      }
+   }
+
+   std::string const name_;
+   mode const mode_;
+   std::size_t const page_size_;
+   int const fd_;
+   detail::shm_header * header_;
+   std::size_t next_event_;
+};
+
+}
+
+namespace notify {
+
+/*
+ * Futex based notification for threading::process_shared: works
+ * across processes.  notify( n ) wakes up n waiters; as with
+ * notify::one all waiters must wait for the same condition.
+ */
+template< typename POLICIY_THREADING >
+class futex {
+public:
+   futex( POLICIY_THREADING & threading )
+      : event_( threading.next_event() ) {
+   }
+
+   void notify() {
+      notify( 1 );
+   }
+
+   void notify( std::size_t const n ) {
+      if( n == 0 ) {
+         return;
+      }
+      event_.epoch.fetch_add( 1, std::memory_order_seq_cst );
+      if( event_.waiters.load( std::memory_order_seq_cst ) != 0 ) {
+         detail::futex_wake(
+            event_.epoch,
+            n >= static_cast< std::size_t >( INT_MAX )
+               ? INT_MAX : static_cast< int >( n ) );
+      }
+   }
+
+   void notify_all() {
+      notify( static_cast< std::size_t >( INT_MAX ) );
+   }
+
+   template< typename PRED >
+   void wait( typename POLICIY_THREADING::lock &, PRED pred ) {
+      while( true ) {
+         std::uint32_t const epoch(
+            event_.epoch.load( std::memory_order_acquire ) );
+         if( pred() ) {
+            return;
+         }
+         event_.waiters.fetch_add( 1, std::memory_order_seq_cst );
+         if( not pred() ) {
+            detail::futex_wait( event_.epoch, epoch, nullptr );
+         }
+         event_.waiters.fetch_sub( 1, std::memory_order_relaxed );
+      }
+   }
+
+   template< typename PRED, typename CLOCK, typename DURATION >
+   bool wait_until(
+      typename POLICIY_THREADING::lock &, PRED pred,
+      std::chrono::time_point< CLOCK, DURATION > const & deadline ) {
+      while( true ) {
+         std::uint32_t const epoch(
+            event_.epoch.load( std::memory_order_acquire ) );
+         if( pred() ) {
+            return true;
+         }
+         std::chrono::nanoseconds const left(
+            std::chrono::duration_cast< std::chrono::nanoseconds >(
+               deadline - CLOCK::now() ) );
+         if( left.count() <= 0 ) {
+            return pred();
+         }
+         struct timespec const timeout = {
+            static_cast< std::time_t >( left.count() / 1000000000 ),
+            static_cast< long >( left.count() % 1000000000 ) };
+         event_.waiters.fetch_add( 1, std::memory_order_seq_cst );
+         if( not pred() ) {
+            detail::futex_wait( event_.epoch, epoch, &timeout );
+         }
+         event_.waiters.fetch_sub( 1, std::memory_order_relaxed );
+      }
+   }
+
+private:
+   detail::futex_event & event_;
+};
+
+}
+
+namespace termination {
+
+/*
+ * The same life cycle as terminatable - but the state lives in the
+ * segment, so that e.g. a consumer process sees the termination of
+ * a producer process.
+ */
+template<>
+class terminatable< threading::process_shared > {
+public:
+   terminatable( threading::process_shared & threading )
+      : header_( threading.header() ) {
+   }
+
+   bool should_terminate() const {
+      return header_.started.load( std::memory_order_acquire ) != 0
+         and header_.terminate_cnt.load( std::memory_order_acquire ) == 0;
+   }
+
+   void start() {
+      if( header_.started.load( std::memory_order_acquire ) != 0 ) {
+         // This should never happen: programing bug:
+         // Start was already called.
+         abort();
+      }
+      if( header_.terminate_cnt.load( std::memory_order_acquire ) == 0 ) {
+         // This should never happen - programming bug:
+         // There was no 'register_terminator' called.
+         abort();
+      }
+      header_.started.store( 1, std::memory_order_release );
+      detail::futex_wake( header_.started, INT_MAX );
+   }
+
+   void terminate( threading::process_shared::lifecycle_lock & ) {
+      // Ensure that the pool was really started.
+      while( header_.started.load( std::memory_order_acquire ) == 0 ) {
+         detail::futex_wait( header_.started, 0, nullptr );
+      }
+      if( header_.terminate_cnt.fetch_sub( 1, std::memory_order_acq_rel )
+          <= 0 ) {
+         // Programming bug:
+         // terminate() was called to often for this pool.
+         abort();
+      }
+   }
+
+   void register_terminator() {
+      if( header_.started.load( std::memory_order_acquire ) != 0 ) {
+         // This should never happen: programing bug:
+         // Start was already called - before finishing to register
+         // all terminators.
+         abort();
+      }
+      header_.terminate_cnt.fetch_add( 1, std::memory_order_acq_rel );
+   }
+
+private:
+   detail::shm_header & header_;
+};
+
+}
+
+namespace container {
+
+/*
+ * Bounded lock free multi producer / multi consumer ring (like
+ * mpmc_ring) in the shared memory segment.  The objects are copied
+ * bytewise between the processes: OBJ_TYPE must be trivially
+ * copyable (and must not contain pointers into one process).
+ */
+template< typename OBJ_TYPE >
+class shm_ring {
+public:
+   static_assert( std::is_trivially_copyable< OBJ_TYPE >::value,
+                  "shm_ring needs a trivially copyable OBJ_TYPE" );
+
+   shm_ring( std::size_t const max_size,
+             threading::process_shared & threading )
+      : threading_( threading ),
+        capacity_( max_size ),
+        bytes_( sizeof( layout ) + max_size * sizeof( slot ) ),
+        layout_( map( threading ) ) {
+   }
+
+   ~shm_ring() {
+      threading_.unmap_container( layout_, bytes_ );
+   }
+
+   shm_ring( shm_ring const & ) = delete;
+   shm_ring & operator=( shm_ring const & ) = delete;
+
+   bool try_push( OBJ_TYPE const & t ) {
+      return try_emplace( t );
+   }
+
+   // The arguments are only used when there is a free slot.
+   template< typename ... ARGS >
+   bool try_emplace( ARGS && ... args ) {
+      std::size_t pos( layout_->tail.load( std::memory_order_relaxed ) );
+      while( true ) {
+         slot & s( slots()[ pos % capacity_ ] );
+         std::size_t const seq( s.seq.load( std::memory_order_acquire ) );
+         std::ptrdiff_t const diff(
+            static_cast< std::ptrdiff_t >( seq - pos ) );
+         if( diff == 0 ) {
+            if( layout_->tail.compare_exchange_weak(
+                   pos, pos + 1, std::memory_order_relaxed ) ) {
+               new( &s.storage ) OBJ_TYPE( std::forward< ARGS >( args ) ... );
+               s.seq.store( pos + 1, std::memory_order_release );
+               return true;
+            }
+         } else if( diff < 0 ) {
+            // The slot was not yet consumed: full.
+            return false;
+         } else {
+            pos = layout_->tail.load( std::memory_order_relaxed );
+         }
+      }
+   }
+
+   bool try_pop( OBJ_TYPE & t ) {
+      std::size_t pos( layout_->head.load( std::memory_order_relaxed ) );
+      while( true ) {
+         slot & s( slots()[ pos % capacity_ ] );
+         std::size_t const seq( s.seq.load( std::memory_order_acquire ) );
+         std::ptrdiff_t const diff(
+            static_cast< std::ptrdiff_t >( seq - ( pos + 1 ) ) );
+         if( diff == 0 ) {
+            if( layout_->head.compare_exchange_weak(
+                   pos, pos + 1, std::memory_order_relaxed ) ) {
+               t = *reinterpret_cast< OBJ_TYPE * >( &s.storage );
+               s.seq.store( pos + capacity_, std::memory_order_release );
+               return true;
+            }
+         } else if( diff < 0 ) {
+            // The slot was not yet written: empty.
+            return false;
+         } else {
+            pos = layout_->head.load( std::memory_order_relaxed );
+         }
+      }
+   }
+
+   // Only a snapshot when used concurrently.
+   std::size_t size() const {
+      std::size_t const head(
+         layout_->head.load( std::memory_order_acquire ) );
+      std::size_t const tail(
+         layout_->tail.load( std::memory_order_acquire ) );
+      return tail > head ? tail - head : 0;
+   }
+
+   bool empty() const {
+      return size() == 0;
+   }
+
+private:
+   class slot {
+   public:
+      std::atomic< std::size_t > seq;
+      typename std::aligned_storage<
+         sizeof( OBJ_TYPE ), alignof( OBJ_TYPE ) >::type storage;
+   };
+
+   // The beginning of the container part of the segment; the
+   // slots follow.
+   class layout {
+   public:
+      std::atomic< std::uint32_t > ready;
+      std::size_t capacity;
+      std::size_t object_size;
+      char pad_0_[ detail::cache_line_size ];
+      std::atomic< std::size_t > head;
+      char pad_1_[ detail::cache_line_size ];
+      std::atomic< std::size_t > tail;
+      char pad_2_[ detail::cache_line_size ];
+   };
+
+   /*
+    * The creator initializes the ring.  Others first only map the
+    * layout and check it: the segment of a ring with a different
+    * size would be too small to be mapped.
+    */
+   layout * map( threading::process_shared & threading ) {
+      if( capacity_ == 0 ) {
+         // Programming bug: a ring needs at least one slot.
+         abort();
+      }
+      if( threading.creator() ) {
+         layout * const rval(
+            static_cast< layout * >( threading.map_container( bytes_ ) ) );
+         rval->capacity = capacity_;
+         rval->object_size = sizeof( OBJ_TYPE );
+         slot * const s( reinterpret_cast< slot * >( rval + 1 ) );
+         for( std::size_t i( 0 ); i < capacity_; ++i ) {
+            s[ i ].seq.store( i, std::memory_order_relaxed );
+         }
+         rval->ready.store( detail::shm_ready_magic,
+                            std::memory_order_release );
+         return rval;
+      }
+
+      layout * const l( static_cast< layout * >(
+                           threading.map_container( sizeof( layout ) ) ) );
+      while( l->ready.load( std::memory_order_acquire )
+             != detail::shm_ready_magic ) {
+         std::this_thread::yield();
+      }
+      bool const same( l->capacity == capacity_
+                       and l->object_size == sizeof( OBJ_TYPE ) );
+      threading.unmap_container( l, sizeof( layout ) );
+      if( not same ) {
+         throw std::runtime_error(
+            "shm_ring: segment has a different layout" );
+      }
+      return static_cast< layout * >( threading.map_container( bytes_ ) );
+   }
+
+   slot * slots() const {
+      return reinterpret_cast< slot * >( layout_ + 1 );
+   }
+
+   threading::process_shared & threading_;
+   std::size_t const capacity_;
+   std::size_t const bytes_;
+   layout * const layout_;
+};
+
+}
+
+}
+
+}}
+
+#endif
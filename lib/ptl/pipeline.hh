@@ -0,0 +1,704 @@
+#ifndef PTL_PIPELINE_HH
+#define PTL_PIPELINE_HH
+
+#include <ptl/object_pool.hh>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/*
+ * Pipeline (staged event driven architecture)
+ * A chain of typed stages: each stage has an input pool and some
+ * workers which pop the objects (in batches), pass them to the
+ * stage's function and push the results (again in batches) into the
+ * input pool of the next stage.  The last stage (sink) only consumes.
+ * As the pools are bounded, a slow stage slows down the stages in
+ * front of it (backpressure).
+ * The life cycle is the one of object_pool::pool: the producers
+ * register (register_terminator()), start() starts all stages, the
+ * producers push and terminate().  When the input of a stage is
+ * terminated and drained, its workers terminate the next stage - so
+ * the termination cascades through the pipeline in order and
+ * everything which was pushed is processed.
+ * The stage functions must not throw (like the function of a
+ * std::thread).
+ *
+ * Usage:
+ *    pipeline< int > p( builder< int >()
+ *       .stage< std::string >( "format", 2, csize, format )
+ *       .sink( "print", 1, csize, print )
+ *       .build() );
+ *    p.register_terminator();
+ *    p.start();
+ *    p.push( 1 );
+ *    p.terminate();
+ *    p.join();
+ */
+namespace ptl { namespace pipeline {
+
+template< typename OBJ_TYPE >
+using default_pool = object_pool::pool<
+   OBJ_TYPE,
+   object_pool::policies::threading::multi,
+   object_pool::policies::notify::one,
+   object_pool::policies::notify::one,
+   object_pool::policies::termination::terminatable,
+   object_pool::policies::container::queue,
+   object_pool::policies::size_handling::constant >;
+
+// Only a snapshot when the pipeline is running.
+class stage_stats {
+public:
+   // Objects per second since start().
+   double throughput() const {
+      return elapsed.count() == 0 ? 0.0
+         : static_cast< double >( processed ) * 1e9 / elapsed.count();
+   }
+
+   std::string name;
+   std::size_t workers;
+   // Number of objects the stage's function was called with.
+   std::uint64_t processed;
+   // Number of objects in the input pool.
+   std::size_t depth;
+   std::chrono::nanoseconds elapsed;
+};
+
+namespace detail {
+
+// The input of a stage.
+template< typename OBJ_TYPE >
+class inlet {
+public:
+   virtual ~inlet() {}
+
+   virtual void register_terminator() = 0;
+   virtual void push( OBJ_TYPE && t ) = 0;
+   // Moves all objects out of the batch.
+   virtual void push_bulk( std::vector< OBJ_TYPE > & batch ) = 0;
+   virtual void terminate() = 0;
+};
+
+/*
+ * Where a stage (or the pipeline's producers) put their results: the
+ * next stage's inlet.  The results of one batch are collected and
+ * pushed at once.
+ */
+template< typename OBJ_TYPE >
+class output {
+public:
+   using batch = std::vector< OBJ_TYPE >;
+
+   output()
+      : inlet_( nullptr ) {
+   }
+
+   // Each producer of this output must terminate the inlet once.
+   void connect( inlet< OBJ_TYPE > & i, std::size_t const producers ) {
+      inlet_ = &i;
+      for( std::size_t p( 0 ); p < producers; ++p ) {
+         inlet_->register_terminator();
+      }
+   }
+
+   inlet< OBJ_TYPE > & next() {
+      return *inlet_;
+   }
+
+   template< typename FUNC, typename IN >
+   void apply( FUNC & f, IN && in, batch & out ) {
+      out.push_back( f( std::forward< IN >( in ) ) );
+   }
+
+   void flush( batch & out ) {
+      if( not out.empty() ) {
+         inlet_->push_bulk( out );
+         out.clear();
+      }
+   }
+
+   void terminate() {
+      inlet_->terminate();
+   }
+
+private:
+   inlet< OBJ_TYPE > * inlet_;
+};
+
+// The output of a sink: there is nothing to pass on.
+template<>
+class output< void > {
+public:
+   class batch {
+   public:
+      void reserve( std::size_t ) {}
+   };
+
+   template< typename FUNC, typename IN >
+   void apply( FUNC & f, IN && in, batch & ) {
+      f( std::forward< IN >( in ) );
+   }
+
+   void flush( batch & ) {}
+   void terminate() {}
+};
+
+class stage_base {
+public:
+   virtual ~stage_base() {}
+
+   virtual void start() = 0;
+   virtual void join() = 0;
+   virtual stage_stats stats() = 0;
+};
+
+template< typename IN, typename OUT, typename POOL, typename FUNC >
+class stage
+   : public stage_base,
+     public inlet< IN > {
+public:
+   template< typename POLICIY_SIZE_HANDLING >
+   stage( std::string const & name, std::size_t const workers,
+          POLICIY_SIZE_HANDLING const & size_handling, FUNC const & f,
+          std::size_t const batch )
+      : name_( name ),
+        workers_( workers ),
+        batch_( batch ),
+        pool_( size_handling ),
+        func_( f ),
+        processed_( 0 ) {
+      if( workers_ == 0 or batch_ == 0 ) {
+         // Programming bug: this stage would never process anything.
+         abort();
+      }
+   }
+
+   output< OUT > & out() {
+      return output_;
+   }
+
+   std::size_t workers() const {
+      return workers_;
+   }
+
+   void register_terminator() override {
+      pool_.register_terminator();
+   }
+
+   void push( IN && t ) override {
+      pool_.push( std::move( t ) );
+   }
+
+   void push_bulk( std::vector< IN > & batch ) override {
+      pool_.push_bulk( std::make_move_iterator( batch.begin() ),
+                       std::make_move_iterator( batch.end() ) );
+   }
+
+   void terminate() override {
+      pool_.terminate();
+   }
+
+   void start() override {
+      start_time_ = std::chrono::steady_clock::now();
+      pool_.start();
+      for( std::size_t i( 0 ); i < workers_; ++i ) {
+         threads_.emplace_back( [this]() { work(); } );
+      }
+   }
+
+   void join() override {
+      for( std::thread & t : threads_ ) {
+         t.join();
+      }
+      threads_.clear();
+   }
+
+   stage_stats stats() override {
+      stage_stats rval;
+      rval.name = name_;
+      rval.workers = workers_;
+      rval.processed = processed_.load( std::memory_order_relaxed );
+      rval.depth = pool_.size();
+      rval.elapsed = std::chrono::duration_cast< std::chrono::nanoseconds >(
+         std::chrono::steady_clock::now() - start_time_ );
+      return rval;
+   }
+
+private:
+   // Runs until the input is terminated and drained; then the
+   // worker terminates the next stage.
+   void work() {
+      std::vector< IN > in;
+      in.reserve( batch_ );
+      typename output< OUT >::batch out;
+      out.reserve( batch_ );
+      try {
+         while( true ) {
+            pool_.pop_bulk( std::back_inserter( in ), batch_ );
+            for( IN & t : in ) {
+               output_.apply( func_, std::move( t ), out );
+            }
+            processed_.fetch_add( in.size(), std::memory_order_relaxed );
+            in.clear();
+            output_.flush( out );
+         }
+      } catch( object_pool::terminate_except const & ) {
+      }
+      output_.terminate();
+   }
+
+   std::string const name_;
+   std::size_t const workers_;
+   std::size_t const batch_;
+   POOL pool_;
+   FUNC func_;
+   output< OUT > output_;
+   std::atomic< std::uint64_t > processed_;
+   std::chrono::steady_clock::time_point start_time_;
+   std::vector< std::thread > threads_;
+};
+
+// An object with its sequence number (for ordered stages).
+template< typename OBJ_TYPE >
+class sequenced {
+public:
+   sequenced()
+      : seq( 0 ) {
+   }
+
+   sequenced( std::uint64_t const s, OBJ_TYPE && v )
+      : seq( s ),
+        value( std::move( v ) ) {
+   }
+
+   std::uint64_t seq;
+   OBJ_TYPE value;
+};
+
+/*
+ * Bounded reorder buffer: results are put with their sequence
+ * number in any order and released strictly in sequence.  A result
+ * which is 'window' or more ahead of the next one to release waits
+ * (backpressure).  Only one thread releases at a time (so the
+ * released batches keep their order); the others only deposit.
+ */
+template< typename OBJ_TYPE >
+class reorder_buffer {
+public:
+   reorder_buffer( std::size_t const window )
+      : window_( window ),
+        slots_( new slot[ window ] ),
+        next_( 0 ),
+        releasing_( false ) {
+      if( window_ == 0 ) {
+         // Programming bug: nothing could ever be put.
+         abort();
+      }
+   }
+
+   reorder_buffer( reorder_buffer const & ) = delete;
+   reorder_buffer & operator=( reorder_buffer const & ) = delete;
+
+   // release( std::vector< OBJ_TYPE > & ) is called (without the
+   // lock) with the results which are now in sequence.
+   template< typename RELEASE >
+   void put( std::uint64_t const seq, OBJ_TYPE && t, RELEASE release ) {
+      std::unique_lock< std::mutex > lock( mutex_ );
+      cv_not_full_.wait( lock, [this, seq]() {
+            return seq < next_ + window_; } );
+      slots_[ seq % window_ ].put( std::move( t ) );
+      if( releasing_ ) {
+         return;
+      }
+      releasing_ = true;
+      while( slots_[ next_ % window_ ].full ) {
+         while( true ) {
+            slot & n( slots_[ next_ % window_ ] );
+            if( not n.full ) {
+               break;
+            }
+            released_.push_back( n.take() );
+            ++next_;
+         }
+         cv_not_full_.notify_all();
+         lock.unlock();
+         release( released_ );
+         released_.clear();
+         lock.lock();
+      }
+      releasing_ = false;
+   }
+
+private:
+   // The result is stored in place: no allocation per result.
+   class slot {
+   public:
+      slot()
+         : full( false ) {
+      }
+
+      ~slot() {
+         if( full ) {
+            object()->~OBJ_TYPE();
+         }
+      }
+
+      void put( OBJ_TYPE && t ) {
+         new( &storage ) OBJ_TYPE( std::move( t ) );
+         full = true;
+      }
+
+      OBJ_TYPE take() {
+         OBJ_TYPE rval( std::move( *object() ) );
+         object()->~OBJ_TYPE();
+         full = false;
+         return rval;
+      }
+
+      OBJ_TYPE * object() {
+         return reinterpret_cast< OBJ_TYPE * >( &storage );
+      }
+
+      typename std::aligned_storage<
+         sizeof( OBJ_TYPE ), alignof( OBJ_TYPE ) >::type storage;
+      bool full;
+   };
+
+   std::size_t const window_;
+   std::unique_ptr< slot[] > const slots_;
+   std::mutex mutex_;
+   std::condition_variable cv_not_full_;
+   // The next sequence number to release.
+   std::uint64_t next_;
+   bool releasing_;
+   // Only used by the releasing thread.
+   std::vector< OBJ_TYPE > released_;
+};
+
+/*
+ * Like stage - but the results are passed on in input order: the
+ * objects get sequence numbers when they are pushed and the results
+ * go through a reorder buffer.  The input pool must be FIFO (so that
+ * the objects are popped in sequence).
+ */
+template< typename IN, typename OUT, typename POOL, typename FUNC >
+class ordered_stage
+   : public stage_base,
+     public inlet< IN > {
+public:
+   template< typename POLICIY_SIZE_HANDLING >
+   ordered_stage( std::string const & name, std::size_t const workers,
+                  POLICIY_SIZE_HANDLING const & size_handling,
+                  FUNC const & f, std::size_t const window,
+                  std::size_t const batch )
+      : name_( name ),
+        workers_( workers ),
+        batch_( batch ),
+        pool_( size_handling ),
+        func_( f ),
+        reorder_( window ),
+        next_seq_( 0 ),
+        processed_( 0 ) {
+      if( workers_ == 0 or batch_ == 0 ) {
+         // Programming bug: this stage would never process anything.
+         abort();
+      }
+   }
+
+   output< OUT > & out() {
+      return output_;
+   }
+
+   void register_terminator() override {
+      pool_.register_terminator();
+   }
+
+   // The sequence number is taken and the object pushed under one
+   // lock: the pool order is the sequence order.
+   void push( IN && t ) override {
+      std::unique_lock< std::mutex > lock( push_mutex_ );
+      pool_.push( sequenced< IN >( next_seq_++, std::move( t ) ) );
+   }
+
+   void push_bulk( std::vector< IN > & batch ) override {
+      std::unique_lock< std::mutex > lock( push_mutex_ );
+      seq_batch_.clear();
+      for( IN & t : batch ) {
+         seq_batch_.emplace_back( next_seq_++, std::move( t ) );
+      }
+      pool_.push_bulk( std::make_move_iterator( seq_batch_.begin() ),
+                       std::make_move_iterator( seq_batch_.end() ) );
+   }
+
+   void terminate() override {
+      pool_.terminate();
+   }
+
+   void start() override {
+      start_time_ = std::chrono::steady_clock::now();
+      pool_.start();
+      for( std::size_t i( 0 ); i < workers_; ++i ) {
+         threads_.emplace_back( [this]() { work(); } );
+      }
+   }
+
+   void join() override {
+      for( std::thread & t : threads_ ) {
+         t.join();
+      }
+      threads_.clear();
+   }
+
+   stage_stats stats() override {
+      stage_stats rval;
+      rval.name = name_;
+      rval.workers = workers_;
+      rval.processed = processed_.load( std::memory_order_relaxed );
+      rval.depth = pool_.size();
+      rval.elapsed = std::chrono::duration_cast< std::chrono::nanoseconds >(
+         std::chrono::steady_clock::now() - start_time_ );
+      return rval;
+   }
+
+private:
+   // A worker only terminates the next stage when all its results
+   // were released (by itself or by the releasing worker).
+   void work() {
+      std::vector< sequenced< IN > > in;
+      in.reserve( batch_ );
+      auto const release( [this]( std::vector< OUT > & results ) {
+            output_.flush( results ); } );
+      try {
+         while( true ) {
+            pool_.pop_bulk( std::back_inserter( in ), batch_ );
+            for( sequenced< IN > & t : in ) {
+               reorder_.put( t.seq, func_( std::move( t.value ) ), release );
+            }
+            processed_.fetch_add( in.size(), std::memory_order_relaxed );
+            in.clear();
+         }
+      } catch( object_pool::terminate_except const & ) {
+      }
+      output_.terminate();
+   }
+
+   std::string const name_;
+   std::size_t const workers_;
+   std::size_t const batch_;
+   POOL pool_;
+   FUNC func_;
+   reorder_buffer< OUT > reorder_;
+   output< OUT > output_;
+   std::mutex push_mutex_;
+   std::uint64_t next_seq_;
+   std::vector< sequenced< IN > > seq_batch_;
+   std::atomic< std::uint64_t > processed_;
+   std::chrono::steady_clock::time_point start_time_;
+   std::vector< std::thread > threads_;
+};
+
+}
+
+template< typename IN >
+class pipeline;
+
+/*
+ * Connects the stages: stage< OUT >() adds a stage which gets the
+ * results of the last one (type LAST) and returns a builder with
+ * OUT as last type; ordered_stage< OUT >() does the same but keeps
+ * the input order.  sink() adds the last stage; build() returns the
+ * pipeline.  Each stage has its own pool type (POOL) with the given
+ * size handling and pops / pushes up to 'batch' objects at once.
+ */
+template< typename IN, typename LAST = IN >
+class builder {
+public:
+   builder()
+      : source_( new detail::output< IN > ),
+        tail_( source_.get() ),
+        tail_workers_( 0 ) {
+   }
+
+   template< typename OUT,
+             template< typename OBJ_TYPE > class POOL = default_pool,
+             typename POLICIY_SIZE_HANDLING, typename FUNC >
+   builder< IN, OUT > stage(
+      std::string const & name, std::size_t const workers,
+      POLICIY_SIZE_HANDLING const & size_handling, FUNC const & f,
+      std::size_t const batch = 16 ) {
+      return add< OUT, POOL< LAST > >(
+         name, workers, size_handling, f, batch );
+   }
+
+   template< template< typename OBJ_TYPE > class POOL = default_pool,
+             typename POLICIY_SIZE_HANDLING, typename FUNC >
+   builder< IN, void > sink(
+      std::string const & name, std::size_t const workers,
+      POLICIY_SIZE_HANDLING const & size_handling, FUNC const & f,
+      std::size_t const batch = 16 ) {
+      return add< void, POOL< LAST > >(
+         name, workers, size_handling, f, batch );
+   }
+
+   /*
+    * Adds a stage whose workers process the objects in parallel but
+    * pass the results on in input order.  At most 'window' results
+    * wait for a slower one; then the workers wait.  (The next stage
+    * sees the results in order when it has only one worker.)
+    */
+   template< typename OUT,
+             template< typename OBJ_TYPE > class POOL = default_pool,
+             typename POLICIY_SIZE_HANDLING, typename FUNC >
+   builder< IN, OUT > ordered_stage(
+      std::string const & name, std::size_t const workers,
+      POLICIY_SIZE_HANDLING const & size_handling, FUNC const & f,
+      std::size_t const window, std::size_t const batch = 16 ) {
+      static_assert( not std::is_void< OUT >::value,
+                     "an ordered stage must have results" );
+      using stage_type = detail::ordered_stage<
+         LAST, OUT, POOL< detail::sequenced< LAST > >, FUNC >;
+      return append< OUT >(
+         std::unique_ptr< stage_type >(
+            new stage_type( name, workers, size_handling, f, window,
+                            batch ) ), workers );
+   }
+
+   pipeline< IN > build() {
+      static_assert( std::is_void< LAST >::value,
+                     "a pipeline must end with a sink" );
+      return pipeline< IN >( std::move( source_ ), std::move( stages_ ) );
+   }
+
+private:
+   using stages = std::vector< std::unique_ptr< detail::stage_base > >;
+
+   builder( std::unique_ptr< detail::output< IN > > && source,
+            stages && s, detail::output< LAST > * const tail,
+            std::size_t const tail_workers )
+      : source_( std::move( source ) ),
+        stages_( std::move( s ) ),
+        tail_( tail ),
+        tail_workers_( tail_workers ) {
+   }
+
+   template< typename OUT, typename POOL, typename POLICIY_SIZE_HANDLING,
+             typename FUNC >
+   builder< IN, OUT > add(
+      std::string const & name, std::size_t const workers,
+      POLICIY_SIZE_HANDLING const & size_handling, FUNC const & f,
+      std::size_t const batch ) {
+      using stage_type = detail::stage< LAST, OUT, POOL, FUNC >;
+      return append< OUT >(
+         std::unique_ptr< stage_type >(
+            new stage_type( name, workers, size_handling, f, batch ) ),
+         workers );
+   }
+
+   template< typename OUT, typename STAGE >
+   builder< IN, OUT > append( std::unique_ptr< STAGE > && s,
+                              std::size_t const workers ) {
+      // The producers of the pipeline register themselves; the
+      // workers of the last stage are the producers of the new one.
+      tail_->connect( *s, tail_workers_ );
+      detail::output< OUT > * const tail( &s->out() );
+      stages_.emplace_back( std::move( s ) );
+      return builder< IN, OUT >(
+         std::move( source_ ), std::move( stages_ ), tail, workers );
+   }
+
+   std::unique_ptr< detail::output< IN > > source_;
+   stages stages_;
+   detail::output< LAST > * tail_;
+   std::size_t tail_workers_;
+
+   template< typename IN_1, typename LAST_1 >
+   friend class builder;
+};
+
+template< typename IN >
+class pipeline {
+public:
+   pipeline( pipeline && ) = default;
+
+   pipeline( pipeline const & ) = delete;
+   pipeline & operator=( pipeline const & ) = delete;
+
+   ~pipeline() {
+      join();
+   }
+
+   // Each producer must register before start().
+   void register_terminator() {
+      source_->next().register_terminator();
+   }
+
+   // Starts all stages (the last one first).
+   void start() {
+      for( auto it( stages_.rbegin() ); it != stages_.rend(); ++it ) {
+         ( *it )->start();
+      }
+   }
+
+   void push( IN const & t ) {
+      source_->next().push( IN( t ) );
+   }
+
+   void push( IN && t ) {
+      source_->next().push( std::move( t ) );
+   }
+
+   // Moves all objects out of the batch.
+   void push_bulk( std::vector< IN > & batch ) {
+      source_->next().push_bulk( batch );
+   }
+
+   void terminate() {
+      source_->next().terminate();
+   }
+
+   // Waits until everything pushed is processed by all stages; all
+   // producers must have terminated.
+   void join() {
+      for( std::unique_ptr< detail::stage_base > & s : stages_ ) {
+         s->join();
+      }
+   }
+
+   // One entry per stage in pipeline order.
+   std::vector< stage_stats > stats() {
+      std::vector< stage_stats > rval;
+      for( std::unique_ptr< detail::stage_base > & s : stages_ ) {
+         rval.push_back( s->stats() );
+      }
+      return rval;
+   }
+
+private:
+   pipeline( std::unique_ptr< detail::output< IN > > && source,
+             std::vector< std::unique_ptr< detail::stage_base > > && s )
+      : source_( std::move( source ) ),
+        stages_( std::move( s ) ) {
+   }
+
+   std::unique_ptr< detail::output< IN > > source_;
+   std::vector< std::unique_ptr< detail::stage_base > > stages_;
+
+   template< typename IN_1, typename LAST_1 >
+   friend class builder;
+};
+
+}}
+
+#endif
@@ -0,0 +1,184 @@
+#include <ptl/disruptor.hh>
+
+#include <thread>
+#include <atomic>
+#include <vector>
+#include <gtest/gtest.h>
+
+class DisruptorTest : public ::testing::Test {
+public:
+};
+
+class Event {
+public:
+   Event() : value( 0 ), doubled( 0 ) {}
+
+   long value;
+   // Written by the first stage.
+   long doubled;
+};
+
+template< typename PRODUCER, typename WAIT >
+using event_ring = ptl::disruptor::ring< Event, PRODUCER, WAIT >;
+
+using sp_yield_ring = event_ring<
+   ptl::disruptor::policies::producer::single,
+   ptl::disruptor::policies::wait::yield >;
+
+using mp_blocking_ring = event_ring<
+   ptl::disruptor::policies::producer::multi,
+   ptl::disruptor::policies::wait::blocking >;
+
+using mp_yield_ring = event_ring<
+   ptl::disruptor::policies::producer::multi,
+   ptl::disruptor::policies::wait::yield >;
+
+// Processes everything until the ring is halted.
+template< typename RING, typename FUNC >
+void consume( RING & r, typename RING::consumer & c, FUNC f ) {
+   while( true ) {
+      std::int64_t const last( c.wait() );
+      if( last < c.next() ) {
+         break;
+      }
+      for( std::int64_t s( c.next() ); s <= last; ++s ) {
+         f( r[ s ] );
+      }
+      c.release( last );
+   }
+}
+
+TEST_F(DisruptorTest, test_size_is_power_of_two) {
+
+   sp_yield_ring r( 100 );
+   ASSERT_EQ( r.size(), 128U );
+}
+
+TEST_F(DisruptorTest, test_claim_publish_in_place) {
+
+   sp_yield_ring r( 4 );
+   sp_yield_ring::consumer & c( r.add_consumer() );
+
+   std::int64_t const last( r.claim( 3 ) );
+   ASSERT_EQ( last, 2 );
+   for( std::int64_t s( 0 ); s <= last; ++s ) {
+      r[ s ].value = s + 10;
+   }
+   r.publish( 0, last );
+
+   ASSERT_EQ( c.next(), 0 );
+   ASSERT_EQ( c.wait(), 2 );
+   Event * const first( &r[ 0 ] );
+   ASSERT_EQ( first->value, 10 );
+   c.release( 2 );
+   ASSERT_EQ( c.next(), 3 );
+   ASSERT_EQ( c.sequence(), 2 );
+
+   // The slots are reused in place.
+   std::int64_t const wrapped( r.claim( 2 ) );
+   ASSERT_EQ( wrapped, 4 );
+   ASSERT_EQ( &r[ 4 ], first );
+
+   r.publish( 3, 4 );
+   r.halt();
+   ASSERT_EQ( c.wait(), 4 );
+   c.release( 4 );
+   ASSERT_EQ( c.wait(), 4 );
+}
+
+// Stage b depends on stage a: it must see what a did.
+template< typename RING >
+void two_stages() {
+   RING r( 64 );
+   typename RING::consumer & a( r.add_consumer() );
+   typename RING::consumer & b( r.add_consumer( { &a } ) );
+   long const cnt( 100000 );
+   long sum( 0 );
+   bool all_doubled( true );
+
+   std::thread ta( [&]() {
+         consume( r, a, []( Event & e ) { e.doubled = e.value * 2; } );
+      } );
+   std::thread tb( [&]() {
+         consume( r, b, [&]( Event & e ) {
+               all_doubled = all_doubled and e.doubled == e.value * 2;
+               sum += e.value;
+            } );
+      } );
+
+   for( long i( 0 ); i < cnt; ++i ) {
+      std::int64_t const seq( r.claim() );
+      r[ seq ].value = i;
+      r[ seq ].doubled = -1;
+      r.publish( seq );
+   }
+   r.halt();
+   ta.join();
+   tb.join();
+
+   ASSERT_TRUE( all_doubled );
+   ASSERT_EQ( sum, ( cnt - 1 ) * cnt / 2 );
+}
+
+TEST_F(DisruptorTest, test_two_stages) {
+   two_stages< sp_yield_ring >();
+}
+
+TEST_F(DisruptorTest, test_two_stages_blocking) {
+   two_stages< mp_blocking_ring >();
+}
+
+// Many producers and two independent consumers which both see all
+// events.
+template< typename RING >
+void fan_out() {
+   RING r( 16 );
+   typename RING::consumer & c1( r.add_consumer() );
+   typename RING::consumer & c2( r.add_consumer() );
+   long const per_producer( 20000 );
+   long sum1( 0 );
+   long sum2( 0 );
+
+   std::thread t1( [&]() {
+         consume( r, c1, [&]( Event & e ) { sum1 += e.value; } );
+      } );
+   std::thread t2( [&]() {
+         consume( r, c2, [&]( Event & e ) { sum2 += e.value; } );
+      } );
+
+   std::vector< std::thread > producers;
+   for( int p( 0 ); p < 4; ++p ) {
+      producers.emplace_back( [&r, per_producer]() {
+            for( long i( 0 ); i < per_producer; i += 2 ) {
+               // Claim and publish in batches of two.
+               std::int64_t const last( r.claim( 2 ) );
+               r[ last - 1 ].value = i;
+               r[ last ].value = i + 1;
+               r.publish( last - 1, last );
+            }
+         } );
+   }
+   for( std::thread & t : producers ) {
+      t.join();
+   }
+   r.halt();
+   t1.join();
+   t2.join();
+
+   long const expected( 4 * ( per_producer - 1 ) * per_producer / 2 );
+   ASSERT_EQ( sum1, expected );
+   ASSERT_EQ( sum2, expected );
+}
+
+TEST_F(DisruptorTest, test_fan_out) {
+   fan_out< mp_yield_ring >();
+}
+
+TEST_F(DisruptorTest, test_fan_out_blocking) {
+   fan_out< mp_blocking_ring >();
+}
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
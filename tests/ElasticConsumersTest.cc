@@ -0,0 +1,130 @@
+#include <ptl/object_pool/elastic.hh>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <gtest/gtest.h>
+
+class ElasticConsumersTest : public ::testing::Test {
+public:
+};
+
+template< typename OBJ_TYPE >
+using mtqueue_stats = ptl::object_pool::pool<
+   OBJ_TYPE,
+   ptl::object_pool::policies::threading::multi,
+   ptl::object_pool::policies::notify::one,
+   ptl::object_pool::policies::notify::one,
+   ptl::object_pool::policies::termination::terminatable,
+   ptl::object_pool::policies::container::queue,
+   ptl::object_pool::policies::size_handling::constant,
+   ptl::object_pool::policies::stats::counting >;
+
+ptl::object_pool::policies::size_handling::constant csize( 1000 );
+
+// Waits (at most some seconds) until pred() is true.
+template< typename PRED >
+bool eventually( PRED pred ) {
+   for( int i( 0 ); i < 500 and not pred(); ++i ) {
+      std::this_thread::sleep_for( std::chrono::milliseconds( 10 ) );
+   }
+   return pred();
+}
+
+TEST_F(ElasticConsumersTest, test_grow_on_depth_and_drain) {
+
+   mtqueue_stats< int > pool( csize );
+   pool.register_terminator();
+   pool.start();
+
+   std::atomic< int > cnt( 0 );
+   ptl::object_pool::elastic_limits limits;
+   limits.min_consumers = 1;
+   limits.max_consumers = 4;
+   limits.max_depth = 2;
+   limits.interval = std::chrono::milliseconds( 1 );
+   auto ec( ptl::object_pool::make_elastic_consumers(
+               pool, [&cnt]( int ) {
+                  std::this_thread::sleep_for(
+                     std::chrono::milliseconds( 1 ) );
+                  ++cnt; },
+               limits ) );
+   ASSERT_EQ( ec->consumers(), 1U );
+
+   for( int i( 0 ); i < 300; ++i ) {
+      pool.push( i );
+   }
+   ASSERT_TRUE( eventually( [&ec]() { return ec->started() > 1; } ) );
+   ASSERT_LE( ec->consumers(), 4U );
+
+   pool.terminate();
+   ec->join();
+   ASSERT_EQ( cnt, 300 );
+   ASSERT_EQ( ec->consumers(), 0U );
+}
+
+TEST_F(ElasticConsumersTest, test_grow_on_dwell_time) {
+
+   mtqueue_stats< int > pool( csize );
+   pool.register_terminator();
+   pool.start();
+
+   ptl::object_pool::elastic_limits limits;
+   limits.min_consumers = 1;
+   limits.max_consumers = 2;
+   limits.max_depth = 1000;
+   limits.max_dwell_time = std::chrono::milliseconds( 1 );
+   limits.interval = std::chrono::milliseconds( 20 );
+   auto ec( ptl::object_pool::make_elastic_consumers(
+               pool, []( int ) {
+                  std::this_thread::sleep_for(
+                     std::chrono::milliseconds( 5 ) ); },
+               limits ) );
+
+   // Few objects - but each waits longer than max_dwell_time.
+   for( int i( 0 ); i < 50; ++i ) {
+      pool.push( i );
+   }
+   ASSERT_TRUE( eventually( [&ec]() { return ec->started() == 2; } ) );
+
+   pool.terminate();
+   ec->join();
+}
+
+TEST_F(ElasticConsumersTest, test_retire_idle_consumers) {
+
+   mtqueue_stats< int > pool( csize );
+   pool.register_terminator();
+   pool.start();
+
+   ptl::object_pool::elastic_limits limits;
+   limits.min_consumers = 2;
+   limits.max_consumers = 4;
+   limits.max_depth = 0;
+   limits.idle_time = std::chrono::milliseconds( 20 );
+   limits.interval = std::chrono::milliseconds( 1 );
+   auto ec( ptl::object_pool::make_elastic_consumers(
+               pool, []( int ) {
+                  std::this_thread::sleep_for(
+                     std::chrono::milliseconds( 1 ) ); },
+               limits ) );
+
+   for( int i( 0 ); i < 200; ++i ) {
+      pool.push( i );
+   }
+   ASSERT_TRUE( eventually( [&ec]() { return ec->started() > 2; } ) );
+   // Without load the consumers retire down to min_consumers.
+   ASSERT_TRUE( eventually( [&ec]() {
+            return ec->consumers() == 2 and ec->started() > 2; } ) );
+   std::this_thread::sleep_for( std::chrono::milliseconds( 100 ) );
+   ASSERT_EQ( ec->consumers(), 2U );
+
+   pool.terminate();
+   ec->join();
+   ASSERT_EQ( ec->consumers(), 0U );
+}
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,120 @@
+#include <ptl/executor.hh>
+
+#include <atomic>
+#include <array>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+#include <gtest/gtest.h>
+
+class ExecutorTest : public ::testing::Test {
+public:
+};
+
+using bounded_pool = ptl::object_pool::pool<
+   ptl::executor::task,
+   ptl::object_pool::policies::threading::multi,
+   ptl::object_pool::policies::notify::one,
+   ptl::object_pool::policies::notify::one,
+   ptl::object_pool::policies::termination::terminatable,
+   ptl::object_pool::policies::container::queue,
+   ptl::object_pool::policies::size_handling::constant,
+   ptl::object_pool::policies::stats::counting >;
+
+TEST_F(ExecutorTest, test_task_small_buffer) {
+
+   int i( 0 );
+   auto const small( [&i]() { ++i; } );
+   std::array< char, 256 > big_data;
+   big_data[ 0 ] = 2;
+   auto const big( [&i, big_data]() { i += big_data[ 0 ]; } );
+   ASSERT_TRUE( ptl::executor::task::fits_inline< decltype( small ) >() );
+   ASSERT_FALSE( ptl::executor::task::fits_inline< decltype( big ) >() );
+
+   ptl::executor::task t1( small );
+   ptl::executor::task t2( big );
+   ptl::executor::task t3( std::move( t2 ) );
+   ASSERT_FALSE( t2 );
+   t1();
+   t3();
+   t2 = std::move( t1 );
+   t2();
+   ASSERT_EQ( i, 4 );
+}
+
+// A callable which can only be moved.
+class MoveOnly {
+public:
+   MoveOnly( int & result, int const value )
+      : result_( result ),
+        value_( new int( value ) ) {
+   }
+
+   void operator()() {
+      result_ = *value_;
+   }
+
+private:
+   int & result_;
+   std::unique_ptr< int > value_;
+};
+
+TEST_F(ExecutorTest, test_task_move_only_callable) {
+
+   int result( 0 );
+   ptl::executor::task t( MoveOnly( result, 7 ) );
+   ptl::executor::task t2( std::move( t ) );
+   t2();
+   ASSERT_EQ( result, 7 );
+}
+
+TEST_F(ExecutorTest, test_post_and_drain) {
+
+   std::atomic< int > cnt( 0 );
+   {
+      ptl::executor::thread_pool<> tp(
+         3, ptl::object_pool::policies::size_handling::unlimited() );
+      ASSERT_EQ( tp.workers(), 3U );
+      for( int i( 0 ); i < 1000; ++i ) {
+         tp.post( [&cnt]() { ++cnt; } );
+      }
+      tp.drain();
+      // All posted tasks are run before drain() returns.
+      ASSERT_EQ( cnt, 1000 );
+   }
+   ASSERT_EQ( cnt, 1000 );
+}
+
+TEST_F(ExecutorTest, test_submit) {
+
+   ptl::executor::thread_pool<> tp(
+      2, ptl::object_pool::policies::size_handling::unlimited() );
+   std::future< int > f( tp.submit( []() { return 42; } ) );
+   std::future< void > e( tp.submit(
+      []() { throw std::runtime_error( "failed" ); } ) );
+   ASSERT_EQ( f.get(), 42 );
+   ASSERT_THROW( e.get(), std::runtime_error );
+}
+
+TEST_F(ExecutorTest, test_post_bulk_with_bounded_pool) {
+
+   std::atomic< int > sum( 0 );
+   ptl::executor::thread_pool< bounded_pool, 4 > tp(
+      2, ptl::object_pool::policies::size_handling::constant( 8 ) );
+   std::vector< std::function< void () > > tasks;
+   for( int i( 1 ); i <= 100; ++i ) {
+      tasks.emplace_back( [&sum, i]() { sum += i; } );
+   }
+   // More tasks than the pool can hold: the producer has to wait.
+   tp.post_bulk( tasks.begin(), tasks.end() );
+   tp.drain();
+   ASSERT_EQ( sum, 5050 );
+   ASSERT_EQ( tp.snapshot().pushes, 100U );
+   ASSERT_EQ( tp.snapshot().pops, 100U );
+}
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
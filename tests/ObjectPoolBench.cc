@@ -0,0 +1,150 @@
+#include <ptl/object_pool.hh>
+
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+
+/*
+ * Benchmarks for the object pool.
+ * This is not run as test case: it must be called by hand.
+ */
+
+template< typename OBJ_TYPE >
+using mtqueue = ptl::object_pool::pool<
+   OBJ_TYPE,
+   ptl::object_pool::policies::threading::multi,
+   ptl::object_pool::policies::notify::all,
+   ptl::object_pool::policies::notify::all,
+   ptl::object_pool::policies::termination::terminatable,
+   ptl::object_pool::policies::container::queue,
+   ptl::object_pool::policies::size_handling::constant >;
+
+template< typename OBJ_TYPE,
+          template< typename OBJ_TYPE_1 > class POLICIY_CONTAINER >
+using stqueue = ptl::object_pool::pool<
+   OBJ_TYPE,
+   ptl::object_pool::policies::threading::single,
+   ptl::object_pool::policies::notify::none,
+   ptl::object_pool::policies::notify::none,
+   ptl::object_pool::policies::termination::run_forever,
+   POLICIY_CONTAINER,
+   ptl::object_pool::policies::size_handling::constant >;
+
+ptl::object_pool::policies::size_handling::constant csize( 1024 );
+
+template< typename FUNC >
+void bench( std::string const & name, long const iterations, FUNC f ) {
+   std::chrono::steady_clock::time_point const start(
+      std::chrono::steady_clock::now() );
+   for( long i( 0 ); i < iterations; ++i ) {
+      f();
+   }
+   std::chrono::duration< double > const secs(
+      std::chrono::steady_clock::now() - start );
+   std::cout << name << " "
+             << static_cast< long >( iterations / secs.count() )
+             << " ops/s" << std::endl;
+}
+
+// A push and pop of a large payload: once copied into the pool and
+// once moved through the pool.
+void bench_payload( std::size_t const payload_size ) {
+   std::string const suffix( "_" + std::to_string( payload_size ) );
+   mtqueue< std::vector< char > > mtqv( csize );
+   std::vector< char > payload( payload_size, 'x' );
+
+   bench( "copy_push_pop" + suffix, 100000, [&]() {
+         mtqv.push( payload );
+         payload = mtqv.pop();
+      } );
+
+   bench( "move_push_pop" + suffix, 100000, [&]() {
+         mtqv.push( std::move( payload ) );
+         payload = mtqv.pop();
+      } );
+}
+
+// The baseline for the single threaded pool: a plain ring of
+// csize slots without any checks.
+void bench_raw_ring() {
+   std::vector< long > ring( csize.max_size() );
+   std::size_t const mask( ring.size() - 1 );
+   std::size_t head( 0 );
+   std::size_t tail( 0 );
+   long sum( 0 );
+
+   bench( "raw_ring_push_pop", 10000000, [&]() {
+         ring[ tail++ & mask ] = sum;
+         sum += ring[ head++ & mask ] + 1;
+      } );
+
+   // Keep the compiler from removing the loop.
+   if( sum == 0 ) {
+      std::cout << sum << std::endl;
+   }
+}
+
+// The single threaded pool must be as fast as the container which
+// it wraps.
+template< template< typename OBJ_TYPE_1 > class POLICIY_CONTAINER >
+void bench_single_threaded( std::string const & name ) {
+   POLICIY_CONTAINER< long > raw( csize.max_size() );
+   stqueue< long, POLICIY_CONTAINER > stql( csize );
+   long sum( 0 );
+
+   bench( "raw_" + name + "_push_pop", 10000000, [&]() {
+         raw.push( sum );
+         sum += raw.pop() + 1;
+      } );
+
+   bench( "single_" + name + "_push_pop", 10000000, [&]() {
+         stql.push( sum );
+         sum += stql.pop() + 1;
+      } );
+
+   // Keep the compiler from removing the loops.
+   if( sum == 0 ) {
+      std::cout << sum << std::endl;
+   }
+}
+
+// The same for a container which only provides try_push() /
+// try_pop().
+template< template< typename OBJ_TYPE_1 > class POLICIY_CONTAINER >
+void bench_single_threaded_try( std::string const & name ) {
+   POLICIY_CONTAINER< long > raw( csize.max_size() );
+   stqueue< long, POLICIY_CONTAINER > stql( csize );
+   long sum( 0 );
+
+   bench( "raw_" + name + "_push_pop", 10000000, [&]() {
+         long v( 0 );
+         raw.try_push( sum );
+         raw.try_pop( v );
+         sum += v + 1;
+      } );
+
+   bench( "single_" + name + "_push_pop", 10000000, [&]() {
+         stql.push( sum );
+         sum += stql.pop() + 1;
+      } );
+
+   // Keep the compiler from removing the loops.
+   if( sum == 0 ) {
+      std::cout << sum << std::endl;
+   }
+}
+
+int main() {
+   bench_payload( 64 );
+   bench_payload( 4096 );
+   bench_payload( 65536 );
+   bench_raw_ring();
+   bench_single_threaded< ptl::object_pool::policies::container::queue >(
+      "queue" );
+   bench_single_threaded< ptl::object_pool::policies::container::segmented >(
+      "segmented" );
+   bench_single_threaded_try<
+      ptl::object_pool::policies::container::spsc_ring >( "spsc_ring" );
+   return 0;
+}
@@ -0,0 +1,265 @@
+#include <ptl/object_pool.hh>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/*
+ * Contention and latency benchmark for the object pool.
+ * This is not run as test case: it must be called by hand:
+ *    ObjectPoolContentionBench [items_per_run]
+ * For every container / notify policy it sweeps the number of
+ * producers and consumers, the payload size and the capacity and
+ * prints one CSV line per run with the throughput and the handoff
+ * latency (time from push to pop) percentiles in nanoseconds.
+ * Busy spinning notify policies are only run when there are enough
+ * hardware threads for all producers and consumers.
+ */
+
+namespace pp = ptl::object_pool::policies;
+
+// An object of (at least) SIZE bytes which carries its push time.
+template< std::size_t SIZE >
+class payload {
+public:
+   payload()
+      : stamp( 0 ) {
+   }
+
+   explicit payload( std::int64_t const s )
+      : stamp( s ) {
+   }
+
+   // For the priority containers: the oldest first.
+   bool operator<( payload const & other ) const {
+      return stamp > other.stamp;
+   }
+
+   std::size_t priority() const {
+      return 0;
+   }
+
+   std::int64_t stamp;
+   char data[ SIZE - sizeof( std::int64_t ) ];
+};
+
+// Just the time stamp: small enough for the ws_deque atomics.
+template<>
+class payload< sizeof( std::int64_t ) > {
+public:
+   payload()
+      : stamp( 0 ) {
+   }
+
+   explicit payload( std::int64_t const s )
+      : stamp( s ) {
+   }
+
+   bool operator<( payload const & other ) const {
+      return stamp > other.stamp;
+   }
+
+   std::size_t priority() const {
+      return 0;
+   }
+
+   std::int64_t stamp;
+};
+
+template< typename OBJ_TYPE,
+          typename POLICIY_THREADING,
+          template< typename POLICIY_THREADING_1 > class POLICIY_NOTIFY,
+          template< typename OBJ_TYPE_1 > class POLICIY_CONTAINER >
+using bench_pool = ptl::object_pool::pool<
+   OBJ_TYPE,
+   POLICIY_THREADING,
+   POLICIY_NOTIFY,
+   POLICIY_NOTIFY,
+   pp::termination::terminatable,
+   POLICIY_CONTAINER,
+   pp::size_handling::constant >;
+
+std::int64_t now_ns() {
+   return std::chrono::duration_cast< std::chrono::nanoseconds >(
+      std::chrono::steady_clock::now().time_since_epoch() ).count();
+}
+
+class run_config {
+public:
+   std::size_t producers;
+   std::size_t consumers;
+   std::size_t payload_size;
+   std::size_t capacity;
+   long items;
+};
+
+void print_header() {
+   std::cout << "container,notify,producers,consumers,payload,capacity,"
+             << "items,ops_per_sec,p50_ns,p99_ns,p999_ns" << std::endl;
+}
+
+// The ws_deque needs its (only) producer registered as owner.
+template< typename POOL >
+void register_owner( POOL & pool, std::true_type ) {
+   pool.register_owner();
+}
+
+template< typename POOL >
+void register_owner( POOL &, std::false_type ) {
+}
+
+template< typename POOL, typename OWNER = std::false_type >
+void run( std::string const & container, std::string const & notify,
+          run_config const & rc ) {
+   POOL pool( pp::size_handling::constant( rc.capacity ) );
+   std::atomic< bool > go( false );
+   std::mutex all_latencies_mutex;
+   std::vector< std::int64_t > all_latencies;
+   all_latencies.reserve( rc.items );
+
+   for( std::size_t i( 0 ); i < rc.producers; ++i ) {
+      pool.register_terminator();
+   }
+
+   std::vector< std::thread > consumers;
+   for( std::size_t i( 0 ); i < rc.consumers; ++i ) {
+      consumers.emplace_back( [&]() {
+            std::vector< std::int64_t > latencies;
+            latencies.reserve( rc.items );
+            while( true ) {
+               ptl::object_pool::pop_result< typename POOL::value_type >
+                  r( pool.pop_or_closed() );
+               if( not r ) {
+                  break;
+               }
+               latencies.push_back( now_ns() - r->stamp );
+            }
+            std::lock_guard< std::mutex > guard( all_latencies_mutex );
+            all_latencies.insert(
+               all_latencies.end(), latencies.begin(), latencies.end() );
+         } );
+   }
+
+   long const per_producer( rc.items / static_cast< long >( rc.producers ) );
+   std::vector< std::thread > producers;
+   for( std::size_t i( 0 ); i < rc.producers; ++i ) {
+      producers.emplace_back( [&]() {
+            register_owner( pool, OWNER() );
+            while( not go ) {
+               std::this_thread::yield();
+            }
+            for( long j( 0 ); j < per_producer; ++j ) {
+               pool.emplace( now_ns() );
+            }
+            pool.terminate();
+         } );
+   }
+
+   pool.start();
+   std::int64_t const start( now_ns() );
+   go = true;
+   for( std::thread & t : producers ) {
+      t.join();
+   }
+   for( std::thread & t : consumers ) {
+      t.join();
+   }
+   std::int64_t const duration( std::max( now_ns() - start,
+                                           std::int64_t( 1 ) ) );
+
+   std::sort( all_latencies.begin(), all_latencies.end() );
+   std::size_t const n( all_latencies.size() );
+   auto const percentile( [&]( double const p ) {
+         return n == 0 ? 0 : all_latencies[
+            std::min( n - 1, static_cast< std::size_t >( n * p ) ) ]; } );
+
+   std::cout << container << "," << notify << ","
+             << rc.producers << "," << rc.consumers << ","
+             << rc.payload_size << "," << rc.capacity << ","
+             << n << ","
+             << static_cast< long >( n * 1e9 / duration ) << ","
+             << percentile( 0.5 ) << ","
+             << percentile( 0.99 ) << ","
+             << percentile( 0.999 ) << std::endl;
+}
+
+template< typename OBJ_TYPE,
+          template< typename POLICIY_THREADING_1 > class POLICIY_NOTIFY >
+void run_notify( std::string const & notify, run_config const & rc ) {
+   run< bench_pool< OBJ_TYPE, pp::threading::multi, POLICIY_NOTIFY,
+                    pp::container::queue > >( "queue", notify, rc );
+   run< bench_pool< OBJ_TYPE, pp::threading::lock_free, POLICIY_NOTIFY,
+                    pp::container::mpmc_ring > >( "mpmc_ring", notify, rc );
+}
+
+template< std::size_t SIZE >
+void sweep( long const items ) {
+   using obj_type = payload< SIZE >;
+   std::size_t const hw_threads( std::thread::hardware_concurrency() );
+   std::size_t const capacities[] = { 16, 1024 };
+   std::size_t const threads[] = { 1, 2, 4 };
+
+   for( std::size_t const capacity : capacities ) {
+      for( std::size_t const producers : threads ) {
+         for( std::size_t const consumers : threads ) {
+            run_config const rc {
+               producers, consumers, SIZE, capacity, items };
+
+            run_notify< obj_type, pp::notify::all >( "all", rc );
+            run_notify< obj_type, pp::notify::one >( "one", rc );
+            run_notify< obj_type, pp::notify::spin_yield >(
+               "spin_yield", rc );
+            run_notify< obj_type, pp::notify::spin_then_park >(
+               "spin_then_park", rc );
+            if( producers + consumers <= hw_threads ) {
+               run_notify< obj_type, pp::notify::spin >( "spin", rc );
+            }
+
+            run< bench_pool< obj_type, pp::threading::multi,
+                             pp::notify::one, pp::container::segmented > >(
+                                "segmented", "one", rc );
+            run< bench_pool< obj_type, pp::threading::multi,
+                             pp::notify::one, pp::container::priority > >(
+                                "priority", "one", rc );
+            run< bench_pool< obj_type, pp::threading::multi,
+                             pp::notify::one,
+                             pp::container::bucket_priority > >(
+                                "bucket_priority", "one", rc );
+            if( producers == 1 and consumers == 1 ) {
+               run< bench_pool< obj_type, pp::threading::lock_free,
+                                pp::notify::one,
+                                pp::container::spsc_ring > >(
+                                   "spsc_ring", "one", rc );
+            }
+            if( producers == 1 and SIZE == sizeof( std::int64_t ) ) {
+               run< bench_pool< obj_type, pp::threading::lock_free,
+                                pp::notify::one,
+                                pp::container::ws_deque >,
+                    std::true_type >( "ws_deque", "one", rc );
+            }
+         }
+      }
+   }
+}
+
+int main( int argc, char ** argv ) {
+   long const items( argc > 1 ? std::atol( argv[ 1 ] ) : 20000 );
+   if( items <= 0 ) {
+      std::cerr << "usage: " << argv[ 0 ] << " [items_per_run]"
+                << std::endl;
+      return 1;
+   }
+
+   print_header();
+   sweep< 8 >( items );
+   sweep< 256 >( items );
+   sweep< 4096 >( items );
+   return 0;
+}
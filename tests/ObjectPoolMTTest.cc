@@ -2,6 +2,8 @@
 
 #include <thread>
 #include <atomic>
+#include <iterator>
+#include <vector>
 #include <gtest/gtest.h>
 
 class ObjectPoolMTTest : public ::testing::Test {
@@ -18,6 +20,100 @@ using mtqueue = ptl::object_pool::pool<
    ptl::object_pool::policies::container::queue,
    ptl::object_pool::policies::size_handling::constant >;
 
+template< typename OBJ_TYPE >
+using lfqueue = ptl::object_pool::pool<
+   OBJ_TYPE,
+   ptl::object_pool::policies::threading::lock_free,
+   ptl::object_pool::policies::notify::all,
+   ptl::object_pool::policies::notify::all,
+   ptl::object_pool::policies::termination::terminatable,
+   ptl::object_pool::policies::container::mpmc_ring,
+   ptl::object_pool::policies::size_handling::constant >;
+
+template< typename OBJ_TYPE >
+using spscqueue = ptl::object_pool::pool<
+   OBJ_TYPE,
+   ptl::object_pool::policies::threading::lock_free,
+   ptl::object_pool::policies::notify::all,
+   ptl::object_pool::policies::notify::all,
+   ptl::object_pool::policies::termination::terminatable,
+   ptl::object_pool::policies::container::spsc_ring,
+   ptl::object_pool::policies::size_handling::constant >;
+
+template< typename OBJ_TYPE >
+using wsdeque = ptl::object_pool::pool<
+   OBJ_TYPE,
+   ptl::object_pool::policies::threading::lock_free,
+   ptl::object_pool::policies::notify::one,
+   ptl::object_pool::policies::notify::one,
+   ptl::object_pool::policies::termination::terminatable,
+   ptl::object_pool::policies::container::ws_deque,
+   ptl::object_pool::policies::size_handling::constant >;
+
+template< typename OBJ_TYPE >
+using mtqueue_one = ptl::object_pool::pool<
+   OBJ_TYPE,
+   ptl::object_pool::policies::threading::multi,
+   ptl::object_pool::policies::notify::one,
+   ptl::object_pool::policies::notify::one,
+   ptl::object_pool::policies::termination::terminatable,
+   ptl::object_pool::policies::container::queue,
+   ptl::object_pool::policies::size_handling::constant >;
+
+template< typename OBJ_TYPE >
+using lfqueue_one = ptl::object_pool::pool<
+   OBJ_TYPE,
+   ptl::object_pool::policies::threading::lock_free,
+   ptl::object_pool::policies::notify::one,
+   ptl::object_pool::policies::notify::one,
+   ptl::object_pool::policies::termination::terminatable,
+   ptl::object_pool::policies::container::mpmc_ring,
+   ptl::object_pool::policies::size_handling::constant >;
+
+template< typename OBJ_TYPE,
+          template< typename POLICIY_THREADING > class POLICIY_NOTIFY >
+using mtqueue_notify = ptl::object_pool::pool<
+   OBJ_TYPE,
+   ptl::object_pool::policies::threading::multi,
+   POLICIY_NOTIFY,
+   POLICIY_NOTIFY,
+   ptl::object_pool::policies::termination::terminatable,
+   ptl::object_pool::policies::container::queue,
+   ptl::object_pool::policies::size_handling::constant >;
+
+template< typename OBJ_TYPE,
+          template< typename POLICIY_THREADING > class POLICIY_NOTIFY >
+using lfqueue_notify = ptl::object_pool::pool<
+   OBJ_TYPE,
+   ptl::object_pool::policies::threading::lock_free,
+   POLICIY_NOTIFY,
+   POLICIY_NOTIFY,
+   ptl::object_pool::policies::termination::terminatable,
+   ptl::object_pool::policies::container::mpmc_ring,
+   ptl::object_pool::policies::size_handling::constant >;
+
+template< typename OBJ_TYPE >
+using lfqueue_stats = ptl::object_pool::pool<
+   OBJ_TYPE,
+   ptl::object_pool::policies::threading::lock_free,
+   ptl::object_pool::policies::notify::one,
+   ptl::object_pool::policies::notify::one,
+   ptl::object_pool::policies::termination::terminatable,
+   ptl::object_pool::policies::container::mpmc_ring,
+   ptl::object_pool::policies::size_handling::constant,
+   ptl::object_pool::policies::stats::counting >;
+
+template< typename OBJ_TYPE >
+using mtqueue_stats = ptl::object_pool::pool<
+   OBJ_TYPE,
+   ptl::object_pool::policies::threading::multi,
+   ptl::object_pool::policies::notify::one,
+   ptl::object_pool::policies::notify::one,
+   ptl::object_pool::policies::termination::terminatable,
+   ptl::object_pool::policies::container::queue,
+   ptl::object_pool::policies::size_handling::constant,
+   ptl::object_pool::policies::stats::counting >;
+
 ptl::object_pool::policies::size_handling::constant csize( 777 );
 
 TEST_F(ObjectPoolMTTest, test_two_threads_simple) {
@@ -109,6 +205,417 @@ TEST_F(ObjectPoolMTTest, test_many_thread_terminate) {
    ASSERT_EQ( overall_cnt.load(), 10000 );
 }
 
+TEST_F(ObjectPoolMTTest, test_lock_free_two_threads_simple_100) {
+
+   lfqueue< int > lfqi( csize );
+
+   std::thread t_send(
+      [&lfqi](){ for( int i(0); i < 100; ++i ) {
+            lfqi.push( i + 9 ); } } );
+   std::thread t_recv(
+      [&lfqi](){
+         for( int i(0); i < 100; ++i ) {
+            int const c( lfqi.pop() );
+            ASSERT_EQ( c, i + 9 ); } } );
+   t_send.join();
+   t_recv.join();
+};
+
+TEST_F(ObjectPoolMTTest, test_lock_free_many_producers_many_consumers) {
+
+   // A small capacity forces producers and consumers to wait.
+   ptl::object_pool::policies::size_handling::constant const csize8( 8 );
+   lfqueue< long > lfql( csize8 );
+   std::atomic_long overall_cnt( 0 );
+   std::atomic_long overall_sum( 0 );
+
+   std::shared_ptr< std::thread > t_recvs[8];
+   std::shared_ptr< std::thread > t_sends[8];
+
+   for( int i( 0 ); i < 8; ++i ) {
+      lfql.register_terminator();
+   }
+
+   for( int i( 0 ); i < 8; ++i ) {
+      t_recvs[ i ] = std::make_shared< std::thread >(
+         [&lfql, &overall_cnt, &overall_sum]() {
+            try {
+               while( true ) {
+                  overall_sum += lfql.pop();
+                  ++overall_cnt;
+               }
+            } catch( ptl::object_pool::terminate_except & te ) {
+               // normal termination...
+            }
+         } );
+   }
+
+   lfql.start();
+
+   for( int i( 0 ); i < 8; ++i ) {
+      t_sends[ i ] = std::make_shared< std::thread >(
+         [&lfql]() {
+            for( long j( 0 ); j < 10000; ++j ) {
+               lfql.push( j );
+            }
+            lfql.terminate();
+         } );
+   }
+
+   for( int i( 0 ); i < 8; ++i ) {
+      t_sends[ i ]->join();
+      t_recvs[ i ]->join();
+   }
+
+   ASSERT_EQ( overall_cnt.load(), 80000 );
+   ASSERT_EQ( overall_sum.load(), 8 * ( 9999L * 10000L / 2 ) );
+}
+
+TEST_F(ObjectPoolMTTest, test_spsc_two_threads_100000) {
+
+   // A small capacity forces both sides to wait.
+   ptl::object_pool::policies::size_handling::constant const csize5( 5 );
+   spscqueue< long > spscql( csize5 );
+
+   std::thread t_send(
+      [&spscql](){
+         for( long i(0); i < 100000; ++i ) {
+            spscql.push( i ); }
+         spscql.terminate(); } );
+   std::thread t_recv(
+      [&spscql](){
+         long expected( 0 );
+         try {
+            while( true ) {
+               ASSERT_EQ( spscql.pop(), expected );
+               ++expected;
+            }
+         } catch( ptl::object_pool::terminate_except & te ) {
+            // normal termination...
+         }
+         ASSERT_EQ( expected, 100000 ); } );
+
+   spscql.register_terminator();
+   spscql.start();
+   t_send.join();
+   t_recv.join();
+}
+
+TEST_F(ObjectPoolMTTest, test_bulk_many_thread_terminate) {
+
+   // The batch is larger than the pool: the producer has to wait.
+   ptl::object_pool::policies::size_handling::constant const csize50( 50 );
+   mtqueue< int > mtqi( csize50 );
+   std::atomic_long overall_cnt( 0 );
+
+   std::shared_ptr< std::thread > t_recvs[8];
+
+   for( int i( 0 ); i < 8; ++i ) {
+      t_recvs[ i ] = std::make_shared< std::thread >(
+         [&mtqi, &overall_cnt]() {
+            std::vector< int > out;
+            try {
+               while( true ) {
+                  out.clear();
+                  overall_cnt += mtqi.pop_bulk(
+                     std::back_inserter( out ), 16 );
+               }
+            } catch( ptl::object_pool::terminate_except & te ) {
+               // normal termination...
+            }
+         } );
+   }
+
+   mtqi.register_terminator();
+   mtqi.start();
+
+   std::vector< int > in( 10000, 99 );
+   mtqi.push_bulk( in.begin(), in.end() );
+
+   mtqi.terminate();
+
+   for( int i( 0 ); i < 8; ++i ) {
+      t_recvs[ i ]->join();
+   }
+
+   ASSERT_EQ( overall_cnt.load(), 10000 );
+}
+
+// Many producers and consumers on a small pool: so that all of
+// them have to wait.
+template< typename POOL >
+void many_producers_many_consumers() {
+   ptl::object_pool::policies::size_handling::constant const csize4( 4 );
+   POOL pool( csize4 );
+   std::atomic_long overall_cnt( 0 );
+
+   std::shared_ptr< std::thread > t_recvs[16];
+   std::shared_ptr< std::thread > t_sends[4];
+
+   for( int i( 0 ); i < 4; ++i ) {
+      pool.register_terminator();
+   }
+
+   for( int i( 0 ); i < 16; ++i ) {
+      t_recvs[ i ] = std::make_shared< std::thread >(
+         [&pool, &overall_cnt]() {
+            try {
+               while( true ) {
+                  pool.pop();
+                  ++overall_cnt;
+               }
+            } catch( ptl::object_pool::terminate_except & te ) {
+               // normal termination...
+            }
+         } );
+   }
+
+   pool.start();
+
+   for( int i( 0 ); i < 4; ++i ) {
+      t_sends[ i ] = std::make_shared< std::thread >(
+         [&pool, i]() {
+            std::vector< int > in( 100, i );
+            for( int j( 0 ); j < 50; ++j ) {
+               pool.push( j );
+               pool.push_bulk( in.begin(), in.end() );
+            }
+            pool.terminate();
+         } );
+   }
+
+   for( int i( 0 ); i < 4; ++i ) {
+      t_sends[ i ]->join();
+   }
+   for( int i( 0 ); i < 16; ++i ) {
+      t_recvs[ i ]->join();
+   }
+
+   ASSERT_EQ( overall_cnt.load(), 4 * 50 * 101 );
+}
+
+TEST_F(ObjectPoolMTTest, test_one_notify_many_producers_many_consumers) {
+   many_producers_many_consumers< mtqueue_one< int > >();
+}
+
+TEST_F(ObjectPoolMTTest,
+       test_lock_free_one_notify_many_producers_many_consumers) {
+   many_producers_many_consumers< lfqueue_one< int > >();
+}
+
+// Busy spinning is only useful when each thread has its own core:
+// therefore this only uses one producer and one consumer.
+template< typename POOL >
+void spin_two_threads() {
+   ptl::object_pool::policies::size_handling::constant const csize4( 4 );
+   POOL pool( csize4 );
+
+   std::thread t_send(
+      [&pool](){ for( int i(0); i < 200; ++i ) {
+            pool.push( i + 9 ); } } );
+   std::thread t_recv(
+      [&pool](){
+         for( int i(0); i < 200; ++i ) {
+            int const c( pool.pop() );
+            ASSERT_EQ( c, i + 9 ); } } );
+   t_send.join();
+   t_recv.join();
+}
+
+TEST_F(ObjectPoolMTTest, test_spin_two_threads) {
+   using namespace ptl::object_pool::policies;
+   spin_two_threads< mtqueue_notify< int, notify::spin > >();
+   spin_two_threads< lfqueue_notify< int, notify::spin > >();
+}
+
+TEST_F(ObjectPoolMTTest, test_spin_yield_many_producers_many_consumers) {
+   using namespace ptl::object_pool::policies;
+   many_producers_many_consumers<
+      mtqueue_notify< int, notify::spin_yield > >();
+   many_producers_many_consumers<
+      lfqueue_notify< int, notify::spin_yield > >();
+}
+
+TEST_F(ObjectPoolMTTest,
+       test_spin_then_park_many_producers_many_consumers) {
+   using namespace ptl::object_pool::policies;
+   many_producers_many_consumers<
+      mtqueue_notify< int, notify::spin_then_park > >();
+   many_producers_many_consumers<
+      lfqueue_notify< int, notify::spin_then_park > >();
+}
+
+TEST_F(ObjectPoolMTTest, test_spin_then_park_linger_timeout) {
+   using namespace ptl::object_pool::policies;
+   mtqueue_notify< int, notify::spin_then_park > mtqi( csize );
+   std::vector< int > out;
+   ASSERT_EQ( mtqi.pop_bulk(
+                 std::back_inserter( out ), 10, 1,
+                 std::chrono::steady_clock::now()
+                 + std::chrono::milliseconds( 10 ) ), 0U );
+}
+
+TEST_F(ObjectPoolMTTest, test_many_thread_pop_or_closed) {
+
+   mtqueue< int > mtqi( csize );
+   std::atomic_long overall_cnt( 0 );
+
+   std::shared_ptr< std::thread > t_recvs[25];
+
+   for( int i( 0 ); i < 25; ++i ) {
+      t_recvs[ i ] = std::make_shared< std::thread >(
+         [&mtqi, &overall_cnt]() {
+            while( mtqi.pop_or_closed() ) {
+               ++overall_cnt;
+            }
+         } );
+   }
+
+   mtqi.register_terminator();
+   mtqi.start();
+
+   for( int i( 0 ); i < 10000; ++i ) {
+      mtqi.push( i + 99 );
+   }
+
+   mtqi.terminate();
+
+   for( int i( 0 ); i < 25; ++i ) {
+      t_recvs[ i ]->join();
+   }
+
+   ASSERT_EQ( overall_cnt.load(), 10000 );
+}
+
+TEST_F(ObjectPoolMTTest, test_pop_for_wakes_up_on_push) {
+
+   lfqueue< int > lfqi( csize );
+
+   std::thread t_recv(
+      [&lfqi](){
+         ptl::object_pool::pop_result< int > r(
+            lfqi.pop_for( std::chrono::seconds( 60 ) ) );
+         ASSERT_EQ( r.status(), ptl::object_pool::pop_status::ok );
+         ASSERT_EQ( *r, 9 ); } );
+   std::this_thread::sleep_for( std::chrono::milliseconds( 10 ) );
+   lfqi.push( 9 );
+   t_recv.join();
+}
+
+TEST_F(ObjectPoolMTTest, test_push_for_wakes_up_on_pop) {
+
+   ptl::object_pool::policies::size_handling::constant const csize1( 1 );
+   mtqueue< int > mtqi( csize1 );
+   mtqi.push( 1 );
+
+   std::thread t_send(
+      [&mtqi](){
+         ASSERT_TRUE( mtqi.push_for( 2, std::chrono::seconds( 60 ) ) ); } );
+   std::this_thread::sleep_for( std::chrono::milliseconds( 10 ) );
+   ASSERT_EQ( mtqi.pop(), 1 );
+   t_send.join();
+   ASSERT_EQ( mtqi.pop(), 2 );
+}
+
+TEST_F(ObjectPoolMTTest, test_ws_deque_thief_is_fifo) {
+
+   wsdeque< int > wsdi( csize );
+   wsdi.register_owner();
+   for( int i( 0 ); i < 10; ++i ) {
+      wsdi.push( i );
+   }
+   std::thread thief( [&wsdi]() {
+         for( int i( 0 ); i < 5; ++i ) {
+            ASSERT_EQ( wsdi.pop(), i );
+         }
+      } );
+   thief.join();
+   for( int i( 9 ); i >= 5; --i ) {
+      ASSERT_EQ( wsdi.pop(), i );
+   }
+}
+
+// The owner pushes (and works on some of the objects itself)
+// while the thieves steal.
+TEST_F(ObjectPoolMTTest, test_ws_deque_owner_and_thieves) {
+
+   ptl::object_pool::policies::size_handling::constant const csize100( 100 );
+   wsdeque< long > wsdl( csize100 );
+   std::atomic_long overall_cnt( 0 );
+   std::atomic_long overall_sum( 0 );
+
+   wsdl.register_terminator();
+
+   std::shared_ptr< std::thread > t_thieves[4];
+   for( int i( 0 ); i < 4; ++i ) {
+      t_thieves[ i ] = std::make_shared< std::thread >(
+         [&wsdl, &overall_cnt, &overall_sum]() {
+            while( true ) {
+               ptl::object_pool::pop_result< long > r(
+                  wsdl.pop_or_closed() );
+               if( not r ) {
+                  break;
+               }
+               overall_sum += *r;
+               ++overall_cnt;
+            }
+         } );
+   }
+
+   std::thread owner( [&wsdl, &overall_cnt, &overall_sum]() {
+         wsdl.register_owner();
+         wsdl.start();
+         for( long j( 0 ); j < 20000; ++j ) {
+            wsdl.push( j );
+            if( j % 3 == 0 ) {
+               ptl::object_pool::pop_result< long > r( wsdl.try_pop() );
+               if( r ) {
+                  overall_sum += *r;
+                  ++overall_cnt;
+               }
+            }
+         }
+         wsdl.terminate();
+      } );
+
+   owner.join();
+   for( int i( 0 ); i < 4; ++i ) {
+      t_thieves[ i ]->join();
+   }
+
+   ASSERT_EQ( overall_cnt.load(), 20000 );
+   ASSERT_EQ( overall_sum.load(), 19999L * 20000L / 2 );
+}
+
+template< typename POOL >
+void stats_blocked_consumer() {
+   POOL pool( csize );
+   std::thread consumer( [&pool]() {
+         ASSERT_EQ( pool.pop(), 7 );
+      } );
+   std::this_thread::sleep_for( std::chrono::milliseconds( 50 ) );
+   pool.push( 7 );
+   consumer.join();
+
+   ptl::object_pool::stats_snapshot const st( pool.snapshot() );
+   ASSERT_EQ( st.pushes, 1U );
+   ASSERT_EQ( st.pops, 1U );
+   ASSERT_EQ( st.consumer_waits, 1U );
+   ASSERT_GE( st.consumer_wait_time, std::chrono::milliseconds( 40 ) );
+}
+
+TEST_F(ObjectPoolMTTest, test_stats_blocked_consumer) {
+   stats_blocked_consumer< mtqueue_stats< int > >();
+}
+
+TEST_F(ObjectPoolMTTest, test_lock_free_stats_blocked_consumer) {
+   stats_blocked_consumer< lfqueue_stats< int > >();
+}
+
+TEST_F(ObjectPoolMTTest, test_stats_many_producers_many_consumers) {
+   many_producers_many_consumers< mtqueue_stats< long > >();
+}
+
 int main(int argc, char **argv) {
   ::testing::InitGoogleTest(&argc, argv);
   return RUN_ALL_TESTS();
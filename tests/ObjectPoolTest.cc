@@ -1,5 +1,9 @@
 #include <ptl/object_pool.hh>
 
+#include <iterator>
+#include <stdexcept>
+#include <thread>
+#include <vector>
 #include <gtest/gtest.h>
 
 class ObjectPoolTest : public ::testing::Test {
@@ -16,9 +20,197 @@ using mtqueue = ptl::object_pool::pool<
    ptl::object_pool::policies::container::queue,
    ptl::object_pool::policies::size_handling::constant >;
 
+template< typename OBJ_TYPE >
+using lfqueue = ptl::object_pool::pool<
+   OBJ_TYPE,
+   ptl::object_pool::policies::threading::lock_free,
+   ptl::object_pool::policies::notify::all,
+   ptl::object_pool::policies::notify::all,
+   ptl::object_pool::policies::termination::terminatable,
+   ptl::object_pool::policies::container::mpmc_ring,
+   ptl::object_pool::policies::size_handling::constant >;
+
+template< typename OBJ_TYPE >
+using spscqueue = ptl::object_pool::pool<
+   OBJ_TYPE,
+   ptl::object_pool::policies::threading::lock_free,
+   ptl::object_pool::policies::notify::all,
+   ptl::object_pool::policies::notify::all,
+   ptl::object_pool::policies::termination::terminatable,
+   ptl::object_pool::policies::container::spsc_ring,
+   ptl::object_pool::policies::size_handling::constant >;
+
+template< typename OBJ_TYPE >
+using wsdeque = ptl::object_pool::pool<
+   OBJ_TYPE,
+   ptl::object_pool::policies::threading::lock_free,
+   ptl::object_pool::policies::notify::all,
+   ptl::object_pool::policies::notify::all,
+   ptl::object_pool::policies::termination::terminatable,
+   ptl::object_pool::policies::container::ws_deque,
+   ptl::object_pool::policies::size_handling::constant >;
+
+template< typename OBJ_TYPE,
+          template< typename OBJ_TYPE_1 > class POLICIY_CONTAINER >
+using mtprio = ptl::object_pool::pool<
+   OBJ_TYPE,
+   ptl::object_pool::policies::threading::multi,
+   ptl::object_pool::policies::notify::all,
+   ptl::object_pool::policies::notify::all,
+   ptl::object_pool::policies::termination::terminatable,
+   POLICIY_CONTAINER,
+   ptl::object_pool::policies::size_handling::constant >;
+
+template< typename OBJ_TYPE >
+using min_priority = ptl::object_pool::policies::container::basic_priority<
+   OBJ_TYPE, std::greater< OBJ_TYPE >, 2 >;
+
+template< typename OBJ_TYPE,
+          template< typename OBJ_TYPE_1 > class POLICIY_CONTAINER >
+using unlimited_queue = ptl::object_pool::pool<
+   OBJ_TYPE,
+   ptl::object_pool::policies::threading::multi,
+   ptl::object_pool::policies::notify::all,
+   ptl::object_pool::policies::notify::all,
+   ptl::object_pool::policies::termination::terminatable,
+   POLICIY_CONTAINER,
+   ptl::object_pool::policies::size_handling::unlimited >;
+
+template< typename OBJ_TYPE >
+using stqueue = ptl::object_pool::pool<
+   OBJ_TYPE,
+   ptl::object_pool::policies::threading::single,
+   ptl::object_pool::policies::notify::none,
+   ptl::object_pool::policies::notify::none,
+   ptl::object_pool::policies::termination::run_forever,
+   ptl::object_pool::policies::container::queue,
+   ptl::object_pool::policies::size_handling::constant >;
+
+template< typename OBJ_TYPE >
+using stspsc = ptl::object_pool::pool<
+   OBJ_TYPE,
+   ptl::object_pool::policies::threading::single,
+   ptl::object_pool::policies::notify::none,
+   ptl::object_pool::policies::notify::none,
+   ptl::object_pool::policies::termination::run_forever,
+   ptl::object_pool::policies::container::spsc_ring,
+   ptl::object_pool::policies::size_handling::constant >;
+
+template< typename OBJ_TYPE >
+using mtqueue_stats = ptl::object_pool::pool<
+   OBJ_TYPE,
+   ptl::object_pool::policies::threading::multi,
+   ptl::object_pool::policies::notify::all,
+   ptl::object_pool::policies::notify::all,
+   ptl::object_pool::policies::termination::terminatable,
+   ptl::object_pool::policies::container::queue,
+   ptl::object_pool::policies::size_handling::constant,
+   ptl::object_pool::policies::stats::counting >;
+
+template< typename OBJ_TYPE >
+using coalescing_stats = ptl::object_pool::pool<
+   OBJ_TYPE,
+   ptl::object_pool::policies::threading::multi,
+   ptl::object_pool::policies::notify::all,
+   ptl::object_pool::policies::notify::all,
+   ptl::object_pool::policies::termination::terminatable,
+   ptl::object_pool::policies::container::coalescing,
+   ptl::object_pool::policies::size_handling::constant,
+   ptl::object_pool::policies::stats::counting >;
+
 class A {
 };
 
+// A message with a priority: the sequence number shows the order
+// in which the messages were pushed.
+class Message {
+public:
+   Message( std::size_t const prio = 0, int const seq = 0 )
+      : prio_( prio ), seq_( seq ) {}
+
+   std::size_t priority() const { return prio_; }
+   int seq() const { return seq_; }
+
+private:
+   std::size_t prio_;
+   int seq_;
+};
+
+// The latest state of an entity: the key is the id of the entity.
+class State {
+public:
+   State( int const id = 0, int const version = 0 )
+      : id_( id ), version_( version ) {}
+
+   int key() const { return id_; }
+   int version() const { return version_; }
+
+private:
+   int id_;
+   int version_;
+};
+
+// A keyed object whose copy constructor throws when asked to.
+class ThrowingCopy {
+public:
+   ThrowingCopy( int const id = 0, int const version = 0 )
+      : id_( id ), version_( version ) {}
+
+   ThrowingCopy( ThrowingCopy const & other )
+      : id_( other.id_ ), version_( other.version_ ) {
+      if( fail ) {
+         throw std::runtime_error( "copy failed" );
+      }
+   }
+
+   ThrowingCopy( ThrowingCopy && other ) = default;
+   ThrowingCopy & operator=( ThrowingCopy const & other ) = default;
+   ThrowingCopy & operator=( ThrowingCopy && other ) = default;
+
+   int key() const { return id_; }
+   int version() const { return version_; }
+
+   static bool fail;
+
+private:
+   int id_;
+   int version_;
+};
+
+bool ThrowingCopy::fail( false );
+
+// Counts the copies which are done.
+class CopyCounter {
+public:
+   CopyCounter( int const v = 0 ) : v_( v ) {}
+
+   CopyCounter( CopyCounter const & other ) : v_( other.v_ ) {
+      ++copies;
+   }
+
+   CopyCounter( CopyCounter && other ) : v_( other.v_ ) {}
+
+   CopyCounter & operator=( CopyCounter const & other ) {
+      v_ = other.v_;
+      ++copies;
+      return *this;
+   }
+
+   CopyCounter & operator=( CopyCounter && other ) {
+      v_ = other.v_;
+      return *this;
+   }
+
+   int get() const { return v_; }
+
+   static int copies;
+
+private:
+   int v_;
+};
+
+int CopyCounter::copies( 0 );
+
 ptl::object_pool::policies::size_handling::constant csize( 777 );
 
 TEST_F(ObjectPoolTest, test_compile) {
@@ -73,6 +265,634 @@ TEST_F(ObjectPoolTest, test_push_and_pop_10) {
    ASSERT_EQ( mtqi.size(), 0U );
 }
 
+TEST_F(ObjectPoolTest, test_lock_free_compile) {
+
+   lfqueue< std::string > const lfqs( csize );
+   (void)lfqs;
+
+   lfqueue< A > const lfqa( csize );
+   (void)lfqa;
+}
+
+TEST_F(ObjectPoolTest, test_lock_free_push_and_pop_10) {
+
+   lfqueue< std::string > lfqs( csize );
+   for( int i( 0 ); i < 10; ++i ) {
+      lfqs.push( std::to_string( i + 7 ) );
+   }
+   ASSERT_EQ( lfqs.size(), 10U );
+   for( int i( 0 ); i < 10; ++i ) {
+      std::string const c( lfqs.pop() );
+      ASSERT_EQ( c, std::to_string( i + 7 ) );
+   }
+   ASSERT_EQ( lfqs.size(), 0U );
+}
+
+TEST_F(ObjectPoolTest, test_lock_free_wrap_around) {
+
+   ptl::object_pool::policies::size_handling::constant const csize3( 3 );
+   lfqueue< int > lfqi( csize3 );
+   for( int i( 0 ); i < 100; ++i ) {
+      lfqi.push( i );
+      lfqi.push( i + 1000 );
+      ASSERT_EQ( lfqi.pop(), i );
+      ASSERT_EQ( lfqi.pop(), i + 1000 );
+   }
+   ASSERT_EQ( lfqi.size(), 0U );
+}
+
+TEST_F(ObjectPoolTest, test_lock_free_terminate_drains) {
+
+   lfqueue< int > lfqi( csize );
+   lfqi.register_terminator();
+   lfqi.start();
+   lfqi.push( 3 );
+   lfqi.terminate();
+   ASSERT_EQ( lfqi.pop(), 3 );
+   ASSERT_THROW( lfqi.pop(), ptl::object_pool::terminate_except );
+}
+
+TEST_F(ObjectPoolTest, test_spsc_push_and_pop_10) {
+
+   spscqueue< std::string > spscqs( csize );
+   for( int i( 0 ); i < 10; ++i ) {
+      spscqs.push( std::to_string( i + 7 ) );
+   }
+   ASSERT_EQ( spscqs.size(), 10U );
+   for( int i( 0 ); i < 10; ++i ) {
+      std::string const c( spscqs.pop() );
+      ASSERT_EQ( c, std::to_string( i + 7 ) );
+   }
+   ASSERT_EQ( spscqs.size(), 0U );
+}
+
+TEST_F(ObjectPoolTest, test_spsc_wrap_around) {
+
+   // The ring has 4 slots, but only 3 are used.
+   ptl::object_pool::policies::size_handling::constant const csize3( 3 );
+   spscqueue< int > spscqi( csize3 );
+   for( int i( 0 ); i < 100; ++i ) {
+      spscqi.push( i );
+      spscqi.push( i + 1000 );
+      spscqi.push( i + 2000 );
+      ASSERT_EQ( spscqi.size(), 3U );
+      ASSERT_EQ( spscqi.pop(), i );
+      ASSERT_EQ( spscqi.pop(), i + 1000 );
+      ASSERT_EQ( spscqi.pop(), i + 2000 );
+   }
+   ASSERT_EQ( spscqi.size(), 0U );
+}
+
+TEST_F(ObjectPoolTest, test_ws_deque_owner_is_lifo) {
+
+   wsdeque< int > wsdi( csize );
+   wsdi.register_owner();
+   for( int i( 0 ); i < 10; ++i ) {
+      wsdi.push( i );
+   }
+   ASSERT_EQ( wsdi.size(), 10U );
+   for( int i( 9 ); i >= 0; --i ) {
+      ASSERT_EQ( wsdi.pop(), i );
+   }
+   ASSERT_EQ( wsdi.size(), 0U );
+   ASSERT_EQ( wsdi.try_pop().status(), ptl::object_pool::pop_status::empty );
+}
+
+TEST_F(ObjectPoolTest, test_ws_deque_grows_up_to_max_size) {
+
+   ptl::object_pool::policies::size_handling::constant const csize200( 200 );
+   wsdeque< int > wsdi( csize200 );
+   wsdi.register_owner();
+   for( int i( 0 ); i < 200; ++i ) {
+      ASSERT_TRUE( wsdi.try_push( i ) );
+   }
+   ASSERT_FALSE( wsdi.try_push( 200 ) );
+   ASSERT_EQ( wsdi.size(), 200U );
+   for( int i( 199 ); i >= 0; --i ) {
+      ASSERT_EQ( wsdi.pop(), i );
+   }
+}
+
+TEST_F(ObjectPoolTest, test_priority) {
+
+   mtprio< int, ptl::object_pool::policies::container::priority >
+      pi( csize );
+   for( int i( 0 ); i < 100; ++i ) {
+      pi.push( ( i * 37 ) % 100 );
+   }
+   ASSERT_EQ( pi.size(), 100U );
+   for( int i( 99 ); i >= 0; --i ) {
+      ASSERT_EQ( pi.pop(), i );
+   }
+   ASSERT_EQ( pi.size(), 0U );
+}
+
+TEST_F(ObjectPoolTest, test_priority_comparator) {
+
+   mtprio< std::unique_ptr< int >, min_priority > pi( csize );
+   for( int i( 0 ); i < 50; ++i ) {
+      pi.emplace( new int( ( i * 7 ) % 50 ) );
+   }
+   // Pointers are compared: only check that all are returned.
+   int sum( 0 );
+   for( int i( 0 ); i < 50; ++i ) {
+      sum += *pi.pop();
+   }
+   ASSERT_EQ( sum, 49 * 50 / 2 );
+
+   mtprio< int, min_priority > mpi( csize );
+   for( int i( 0 ); i < 50; ++i ) {
+      mpi.push( ( i * 7 ) % 50 );
+   }
+   for( int i( 0 ); i < 50; ++i ) {
+      ASSERT_EQ( mpi.pop(), i );
+   }
+}
+
+TEST_F(ObjectPoolTest, test_bucket_priority) {
+
+   mtprio< Message, ptl::object_pool::policies::container::bucket_priority >
+      pm( csize );
+   for( int i( 0 ); i < 40; ++i ) {
+      pm.emplace( i % 8, i );
+   }
+   ASSERT_EQ( pm.size(), 40U );
+   // Highest priority first; FIFO within one priority.
+   for( int level( 7 ); level >= 0; --level ) {
+      for( int j( 0 ); j < 5; ++j ) {
+         Message const m( pm.pop() );
+         ASSERT_EQ( m.priority(), static_cast< std::size_t >( level ) );
+         ASSERT_EQ( m.seq(), level + j * 8 );
+      }
+   }
+   ASSERT_EQ( pm.size(), 0U );
+}
+
+TEST_F(ObjectPoolTest, test_coalescing) {
+
+   mtprio< State, ptl::object_pool::policies::container::coalescing >
+      ps( csize );
+   ps.emplace( 1, 0 );
+   ps.emplace( 2, 0 );
+   ps.push( State( 1, 1 ) );
+   ps.emplace( 3, 0 );
+   ps.emplace( 2, 1 );
+   ASSERT_EQ( ps.size(), 3U );
+   // The replaced objects keep their position.
+   State const s1( ps.pop() );
+   ASSERT_EQ( s1.key(), 1 );
+   ASSERT_EQ( s1.version(), 1 );
+   State const s2( ps.pop() );
+   ASSERT_EQ( s2.key(), 2 );
+   ASSERT_EQ( s2.version(), 1 );
+   // A popped key is pushed again at the end.
+   ps.emplace( 1, 2 );
+   ASSERT_EQ( ps.pop().key(), 3 );
+   State const s3( ps.pop() );
+   ASSERT_EQ( s3.key(), 1 );
+   ASSERT_EQ( s3.version(), 2 );
+   ASSERT_EQ( ps.size(), 0U );
+}
+
+TEST_F(ObjectPoolTest, test_coalescing_bounded_by_keys) {
+
+   ptl::object_pool::policies::size_handling::unlimited const usize;
+   unlimited_queue< State, ptl::object_pool::policies::container::coalescing >
+      ps( usize );
+   for( int i( 0 ); i < 1000; ++i ) {
+      ps.emplace( i % 10, i );
+      ASSERT_LE( ps.size(), 10U );
+   }
+   ASSERT_EQ( ps.size(), 10U );
+   for( int k( 0 ); k < 10; ++k ) {
+      State const s( ps.pop() );
+      ASSERT_EQ( s.key(), k );
+      ASSERT_EQ( s.version(), 990 + k );
+   }
+}
+
+TEST_F(ObjectPoolTest, test_coalescing_stats) {
+
+   coalescing_stats< State > ps( csize );
+   for( int i( 0 ); i < 100; ++i ) {
+      ps.emplace( i % 10, i );
+   }
+   std::vector< State > batch;
+   for( int i( 0 ); i < 10; ++i ) {
+      batch.push_back( State( i, 100 + i ) );
+   }
+   ps.push_bulk( batch.begin(), batch.end() );
+
+   // Only the inserts are counted: the replaced objects are never
+   // popped.
+   ASSERT_EQ( ps.snapshot().pushes, 10U );
+   std::vector< State > out;
+   ASSERT_EQ( ps.pop_bulk( std::back_inserter( out ), 100 ), 10U );
+   ASSERT_EQ( out.back().version(), 109 );
+   ptl::object_pool::stats_snapshot const st( ps.snapshot() );
+   ASSERT_EQ( st.pushes, st.pops );
+   ASSERT_EQ( st.high_water_mark, 10U );
+
+   // Nothing is left in the pool: the dwell time does not grow.
+   std::this_thread::sleep_for( std::chrono::milliseconds( 20 ) );
+   ASSERT_EQ( ps.snapshot().dwell_time, st.dwell_time );
+}
+
+TEST_F(ObjectPoolTest, test_coalescing_push_throws) {
+
+   ptl::object_pool::policies::container::coalescing< ThrowingCopy >
+      c( 10 );
+   ThrowingCopy const t1( 1, 1 );
+   ThrowingCopy::fail = true;
+   ASSERT_THROW( c.push( t1 ), std::runtime_error );
+   ThrowingCopy::fail = false;
+   ASSERT_EQ( c.size(), 0U );
+
+   // The failed push left no index entry: the key is inserted again.
+   ASSERT_TRUE( c.push( ThrowingCopy( 1, 2 ) ) );
+   ASSERT_FALSE( c.push( ThrowingCopy( 1, 3 ) ) );
+   ASSERT_EQ( c.size(), 1U );
+   ASSERT_EQ( c.pop().version(), 3 );
+   ASSERT_TRUE( c.empty() );
+}
+
+TEST_F(ObjectPoolTest, test_unlimited) {
+
+   ptl::object_pool::policies::size_handling::unlimited const usize;
+   unlimited_queue< int, ptl::object_pool::policies::container::queue >
+      uqi( usize );
+   unlimited_queue< std::string,
+                    ptl::object_pool::policies::container::segmented >
+      usqs( usize );
+   for( int i( 0 ); i < 10000; ++i ) {
+      ASSERT_TRUE( uqi.try_push( i ) );
+      usqs.push( std::to_string( i ) );
+   }
+   ASSERT_FALSE( uqi.full() );
+   ASSERT_EQ( usqs.size(), 10000U );
+   for( int i( 0 ); i < 10000; ++i ) {
+      ASSERT_EQ( uqi.pop(), i );
+      ASSERT_EQ( usqs.pop(), std::to_string( i ) );
+   }
+}
+
+TEST_F(ObjectPoolTest, test_segmented_releases_memory) {
+
+   // Segments with 4 slots; free segments are only kept with at
+   // least 8 objects.
+   ptl::object_pool::policies::container::basic_segmented< int, 4, 8 >
+      seg( 0 );
+   ASSERT_EQ( seg.capacity(), 4U );
+   for( int i( 0 ); i < 1000; ++i ) {
+      seg.push( i );
+   }
+   ASSERT_EQ( seg.capacity(), 1000U );
+   for( int i( 0 ); i < 500; ++i ) {
+      ASSERT_EQ( seg.pop(), i );
+   }
+   // At most as many free as used segments.
+   ASSERT_LE( seg.capacity(), 2 * 504U );
+   for( int i( 500 ); i < 995; ++i ) {
+      ASSERT_EQ( seg.pop(), i );
+   }
+   // Below the low watermark: only the used segments are kept.
+   ASSERT_EQ( seg.size(), 5U );
+   ASSERT_LE( seg.capacity(), 8U );
+   for( int i( 995 ); i < 1000; ++i ) {
+      ASSERT_EQ( seg.pop(), i );
+   }
+   ASSERT_TRUE( seg.empty() );
+   ASSERT_EQ( seg.capacity(), 4U );
+   // Reuses the only segment.
+   seg.push( 7 );
+   ASSERT_EQ( seg.capacity(), 4U );
+   ASSERT_EQ( seg.pop(), 7 );
+}
+
+TEST_F(ObjectPoolTest, test_single_threaded) {
+
+   ptl::object_pool::policies::size_handling::constant const csize3( 3 );
+   stqueue< std::string > stqs( csize3 );
+   stqs.start();
+   stqs.push( "a" );
+   stqs.emplace( 2, 'b' );
+   ASSERT_TRUE( stqs.try_push( "c" ) );
+   ASSERT_FALSE( stqs.try_push( "d" ) );
+   ASSERT_FALSE( stqs.push_for( "d", std::chrono::milliseconds( 100 ) ) );
+   ASSERT_TRUE( stqs.full() );
+   ASSERT_EQ( stqs.pop(), "a" );
+   ASSERT_EQ( stqs.pop(), "bb" );
+   ASSERT_EQ( *stqs.try_pop(), "c" );
+   ASSERT_FALSE( stqs.should_terminate() );
+   ASSERT_EQ( stqs.try_pop().status(), ptl::object_pool::pop_status::empty );
+   ASSERT_EQ( stqs.pop_for( std::chrono::milliseconds( 100 ) ).status(),
+              ptl::object_pool::pop_status::timeout );
+
+   std::vector< std::string > const in { "x", "y" };
+   stqs.push_bulk( in.begin(), in.end() );
+   std::vector< std::string > out;
+   ASSERT_EQ( stqs.pop_bulk( std::back_inserter( out ), 5 ), 2U );
+   ASSERT_EQ( out, in );
+}
+
+TEST_F(ObjectPoolTest, test_single_threaded_ring) {
+
+   ptl::object_pool::policies::size_handling::constant const csize4( 4 );
+   stspsc< int > stri( csize4 );
+   for( int round( 0 ); round < 3; ++round ) {
+      for( int i( 0 ); i < 4; ++i ) {
+         stri.push( round * 4 + i );
+      }
+      ASSERT_FALSE( stri.try_push( 99 ) );
+      ASSERT_TRUE( stri.full() );
+      for( int i( 0 ); i < 4; ++i ) {
+         ASSERT_EQ( stri.pop(), round * 4 + i );
+      }
+      ASSERT_EQ( stri.try_pop().status(),
+                 ptl::object_pool::pop_status::empty );
+   }
+}
+
+TEST_F(ObjectPoolTest, test_single_threaded_pop_empty_aborts) {
+
+   stqueue< int > stqi( csize );
+   ASSERT_DEATH( stqi.pop(), "" );
+}
+
+TEST_F(ObjectPoolTest, test_stats_none) {
+
+   mtqueue< int > mtqi( csize );
+   mtqi.push( 1 );
+   mtqi.pop();
+   ptl::object_pool::stats_snapshot const st( mtqi.snapshot() );
+   ASSERT_EQ( st.pushes, 0U );
+   ASSERT_EQ( st.pops, 0U );
+   ASSERT_EQ( st.high_water_mark, 0U );
+}
+
+TEST_F(ObjectPoolTest, test_stats_counting) {
+
+   mtqueue_stats< int > mtqi( csize );
+   for( int i( 0 ); i < 3; ++i ) {
+      mtqi.push( i );
+   }
+   std::this_thread::sleep_for( std::chrono::milliseconds( 20 ) );
+   mtqi.pop();
+   std::vector< int > out;
+   mtqi.pop_bulk( std::back_inserter( out ), 10 );
+   mtqi.push( 7 );
+   ASSERT_EQ( mtqi.try_pop().status(), ptl::object_pool::pop_status::ok );
+   ASSERT_EQ( mtqi.try_pop().status(), ptl::object_pool::pop_status::empty );
+
+   ptl::object_pool::stats_snapshot const st( mtqi.snapshot() );
+   ASSERT_EQ( st.pushes, 4U );
+   ASSERT_EQ( st.pops, 4U );
+   ASSERT_EQ( st.high_water_mark, 3U );
+   ASSERT_EQ( st.producer_waits, 0U );
+   ASSERT_EQ( st.consumer_waits, 0U );
+   ASSERT_EQ( st.contended_locks, 0U );
+   // Three objects were at least 20ms in the pool.
+   ASSERT_GE( st.dwell_time, std::chrono::milliseconds( 60 ) );
+   ASSERT_GE( st.mean_dwell_time(), std::chrono::milliseconds( 15 ) );
+}
+
+TEST_F(ObjectPoolTest, test_stats_timed_waits) {
+
+   ptl::object_pool::policies::size_handling::constant const csize1( 1 );
+   mtqueue_stats< int > mtqi( csize1 );
+   ASSERT_FALSE( mtqi.pop_for( std::chrono::milliseconds( 20 ) ) );
+   mtqi.push( 1 );
+   ASSERT_FALSE( mtqi.push_for( 2, std::chrono::milliseconds( 20 ) ) );
+   // try_* never wait.
+   ASSERT_FALSE( mtqi.try_push( 2 ) );
+
+   ptl::object_pool::stats_snapshot const st( mtqi.snapshot() );
+   ASSERT_EQ( st.consumer_waits, 1U );
+   ASSERT_GE( st.consumer_wait_time, std::chrono::milliseconds( 20 ) );
+   ASSERT_EQ( st.producer_waits, 1U );
+   ASSERT_GE( st.producer_wait_time, std::chrono::milliseconds( 20 ) );
+   ASSERT_EQ( st.pushes, 1U );
+}
+
+TEST_F(ObjectPoolTest, test_push_bulk_and_pop_bulk) {
+
+   mtqueue< int > mtqi( csize );
+   std::vector< int > const in { 1, 2, 3, 4, 5, 6, 7 };
+   mtqi.push_bulk( in.begin(), in.end() );
+   ASSERT_EQ( mtqi.size(), 7U );
+
+   std::vector< int > out;
+   ASSERT_EQ( mtqi.pop_bulk( std::back_inserter( out ), 5 ), 5U );
+   ASSERT_EQ( mtqi.pop_bulk( std::back_inserter( out ), 5 ), 2U );
+   ASSERT_EQ( out, in );
+   ASSERT_EQ( mtqi.size(), 0U );
+}
+
+TEST_F(ObjectPoolTest, test_lock_free_push_bulk_and_pop_bulk) {
+
+   lfqueue< int > lfqi( csize );
+   std::vector< int > const in { 1, 2, 3, 4, 5, 6, 7 };
+   lfqi.push_bulk( in.begin(), in.end() );
+
+   std::vector< int > out;
+   ASSERT_EQ( lfqi.pop_bulk( std::back_inserter( out ), 100 ), 7U );
+   ASSERT_EQ( out, in );
+}
+
+TEST_F(ObjectPoolTest, test_pop_bulk_linger) {
+
+   mtqueue< int > mtqi( csize );
+   std::vector< int > const in { 1, 2, 3 };
+   mtqi.push_bulk( in.begin(), in.end() );
+
+   // Not enough elements: the deadline is reached and the available
+   // ones are returned.
+   std::vector< int > out;
+   ASSERT_EQ( mtqi.pop_bulk(
+                 std::back_inserter( out ), 10, 5,
+                 std::chrono::steady_clock::now()
+                 + std::chrono::milliseconds( 10 ) ), 3U );
+   ASSERT_EQ( out, in );
+
+   // Nothing available at all.
+   ASSERT_EQ( mtqi.pop_bulk(
+                 std::back_inserter( out ), 10, 1,
+                 std::chrono::steady_clock::now()
+                 + std::chrono::milliseconds( 10 ) ), 0U );
+}
+
+TEST_F(ObjectPoolTest, test_pop_bulk_terminated) {
+
+   mtqueue< int > mtqi( csize );
+   mtqi.register_terminator();
+   mtqi.start();
+   mtqi.push( 1 );
+   mtqi.terminate();
+
+   std::vector< int > out;
+   ASSERT_EQ( mtqi.pop_bulk( std::back_inserter( out ), 10 ), 1U );
+   ASSERT_THROW( mtqi.pop_bulk( std::back_inserter( out ), 10 ),
+                 ptl::object_pool::terminate_except );
+}
+
+TEST_F(ObjectPoolTest, test_pop_bulk_zero) {
+
+   mtqueue< int > mtqi( csize );
+   lfqueue< int > lfqi( csize );
+   mtqi.register_terminator();
+   mtqi.start();
+   mtqi.push( 1 );
+   lfqi.push( 1 );
+
+   std::vector< int > out;
+   ASSERT_EQ( mtqi.pop_bulk( std::back_inserter( out ), 0 ), 0U );
+   ASSERT_EQ( lfqi.pop_bulk( std::back_inserter( out ), 0 ), 0U );
+   ASSERT_EQ( mtqi.pop_bulk( std::back_inserter( out ), 0, 0,
+                             std::chrono::steady_clock::now() ), 0U );
+   // Terminated but not drained: nothing is thrown.
+   mtqi.terminate();
+   ASSERT_EQ( mtqi.pop_bulk( std::back_inserter( out ), 0 ), 0U );
+   ASSERT_TRUE( out.empty() );
+   ASSERT_EQ( mtqi.size(), 1U );
+   ASSERT_EQ( lfqi.size(), 1U );
+}
+
+TEST_F(ObjectPoolTest, test_move_only) {
+
+   mtqueue< std::unique_ptr< int > > mtqu( csize );
+   mtqu.push( std::unique_ptr< int >( new int( 7 ) ) );
+   std::unique_ptr< int > const p( mtqu.pop() );
+   ASSERT_EQ( *p, 7 );
+
+   lfqueue< std::unique_ptr< int > > lfqu( csize );
+   lfqu.push( std::unique_ptr< int >( new int( 8 ) ) );
+   std::unique_ptr< int > const q( lfqu.pop() );
+   ASSERT_EQ( *q, 8 );
+}
+
+TEST_F(ObjectPoolTest, test_no_copies) {
+
+   CopyCounter::copies = 0;
+
+   mtqueue< CopyCounter > mtqc( csize );
+   mtqc.push( CopyCounter( 1 ) );
+   mtqc.emplace( 2 );
+   ASSERT_EQ( mtqc.pop().get(), 1 );
+   ASSERT_EQ( mtqc.pop().get(), 2 );
+
+   lfqueue< CopyCounter > lfqc( csize );
+   lfqc.push( CopyCounter( 3 ) );
+   lfqc.emplace( 4 );
+   ASSERT_EQ( lfqc.pop().get(), 3 );
+   ASSERT_EQ( lfqc.pop().get(), 4 );
+
+   spscqueue< CopyCounter > spscqc( csize );
+   spscqc.push( CopyCounter( 5 ) );
+   spscqc.emplace( 6 );
+   ASSERT_EQ( spscqc.pop().get(), 5 );
+   ASSERT_EQ( spscqc.pop().get(), 6 );
+
+   ASSERT_EQ( CopyCounter::copies, 0 );
+
+   // A push of an lvalue does exactly one copy.
+   CopyCounter const c( 9 );
+   mtqc.push( c );
+   ASSERT_EQ( mtqc.pop().get(), 9 );
+   ASSERT_EQ( CopyCounter::copies, 1 );
+}
+
+TEST_F(ObjectPoolTest, test_pop_or_closed) {
+
+   mtqueue< std::unique_ptr< int > > mtqu( csize );
+   mtqu.register_terminator();
+   mtqu.start();
+   mtqu.push( std::unique_ptr< int >( new int( 7 ) ) );
+   mtqu.terminate();
+
+   ptl::object_pool::pop_result< std::unique_ptr< int > > r1(
+      mtqu.pop_or_closed() );
+   ASSERT_TRUE( static_cast< bool >( r1 ) );
+   ASSERT_EQ( r1.status(), ptl::object_pool::pop_status::ok );
+   ASSERT_EQ( **r1, 7 );
+
+   ptl::object_pool::pop_result< std::unique_ptr< int > > r2(
+      mtqu.pop_or_closed() );
+   ASSERT_FALSE( static_cast< bool >( r2 ) );
+   ASSERT_EQ( r2.status(), ptl::object_pool::pop_status::closed );
+}
+
+TEST_F(ObjectPoolTest, test_lock_free_pop_or_closed) {
+
+   lfqueue< std::string > lfqs( csize );
+   lfqs.register_terminator();
+   lfqs.start();
+   lfqs.push( "Hello" );
+   lfqs.terminate();
+
+   ptl::object_pool::pop_result< std::string > r1( lfqs.pop_or_closed() );
+   ASSERT_EQ( r1.status(), ptl::object_pool::pop_status::ok );
+   ASSERT_EQ( *r1, "Hello" );
+   ASSERT_EQ( r1->size(), 5U );
+
+   ASSERT_EQ( lfqs.pop_or_closed().status(),
+              ptl::object_pool::pop_status::closed );
+}
+
+template< typename POOL >
+void try_and_timed_operations() {
+   ptl::object_pool::policies::size_handling::constant const csize2( 2 );
+   POOL pool( csize2 );
+
+   ASSERT_EQ( pool.try_pop().status(), ptl::object_pool::pop_status::empty );
+   ASSERT_EQ( pool.pop_for( std::chrono::milliseconds( 5 ) ).status(),
+              ptl::object_pool::pop_status::timeout );
+
+   ASSERT_TRUE( pool.try_push( 1 ) );
+   ASSERT_TRUE( pool.push_for( 2, std::chrono::milliseconds( 5 ) ) );
+   ASSERT_FALSE( pool.try_push( 3 ) );
+   ASSERT_FALSE( pool.push_for( 3, std::chrono::milliseconds( 5 ) ) );
+   ASSERT_FALSE( pool.push_until(
+                    3, std::chrono::steady_clock::now()
+                    + std::chrono::milliseconds( 5 ) ) );
+   ASSERT_EQ( pool.size(), 2U );
+
+   ptl::object_pool::pop_result< int > r1( pool.try_pop() );
+   ASSERT_EQ( r1.status(), ptl::object_pool::pop_status::ok );
+   ASSERT_EQ( *r1, 1 );
+   ptl::object_pool::pop_result< int > r2(
+      pool.pop_until( std::chrono::steady_clock::now()
+                      + std::chrono::milliseconds( 5 ) ) );
+   ASSERT_EQ( r2.status(), ptl::object_pool::pop_status::ok );
+   ASSERT_EQ( *r2, 2 );
+
+   pool.register_terminator();
+   pool.start();
+   pool.terminate();
+   ASSERT_EQ( pool.try_pop().status(),
+              ptl::object_pool::pop_status::closed );
+   ASSERT_EQ( pool.pop_for( std::chrono::milliseconds( 5 ) ).status(),
+              ptl::object_pool::pop_status::closed );
+}
+
+TEST_F(ObjectPoolTest, test_try_and_timed_operations) {
+   try_and_timed_operations< mtqueue< int > >();
+}
+
+TEST_F(ObjectPoolTest, test_lock_free_try_and_timed_operations) {
+   try_and_timed_operations< lfqueue< int > >();
+   try_and_timed_operations< spscqueue< int > >();
+}
+
+TEST_F(ObjectPoolTest, test_failed_try_push_does_not_move) {
+   ptl::object_pool::policies::size_handling::constant const csize1( 1 );
+   mtqueue< std::unique_ptr< int > > mtqu( csize1 );
+   mtqu.push( std::unique_ptr< int >( new int( 1 ) ) );
+
+   std::unique_ptr< int > p( new int( 2 ) );
+   ASSERT_FALSE( mtqu.try_push( std::move( p ) ) );
+   ASSERT_TRUE( static_cast< bool >( p ) );
+}
+
 int main(int argc, char **argv) {
   ::testing::InitGoogleTest(&argc, argv);
   return RUN_ALL_TESTS();
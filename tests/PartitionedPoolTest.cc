@@ -0,0 +1,167 @@
+#include <ptl/object_pool/partitioned.hh>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <gtest/gtest.h>
+
+class PartitionedPoolTest : public ::testing::Test {
+public:
+};
+
+template< typename OBJ_TYPE >
+using mtqueue = ptl::object_pool::pool<
+   OBJ_TYPE,
+   ptl::object_pool::policies::threading::multi,
+   ptl::object_pool::policies::notify::one,
+   ptl::object_pool::policies::notify::one,
+   ptl::object_pool::policies::termination::terminatable,
+   ptl::object_pool::policies::container::queue,
+   ptl::object_pool::policies::size_handling::constant >;
+
+// The key is the hash: so the lanes of the keys are known.
+class identity {
+public:
+   std::size_t operator()( int const k ) const {
+      return static_cast< std::size_t >( k );
+   }
+};
+
+using ppool = ptl::object_pool::partitioned_pool<
+   int, int, mtqueue,
+   ptl::object_pool::policies::rebalance::none, identity >;
+
+using rebalancing_ppool = ptl::object_pool::partitioned_pool<
+   int, int, mtqueue,
+   ptl::object_pool::policies::rebalance::buckets, identity >;
+
+ptl::object_pool::policies::size_handling::constant csize( 100 );
+
+TEST_F(PartitionedPoolTest, test_route_by_key) {
+
+   ppool pp( 3, csize );
+   ASSERT_EQ( pp.lanes(), 3U );
+   pp.push( 1, 10 );
+   pp.push( 4, 40 );
+   pp.push( 2, 20 );
+   ASSERT_EQ( pp.size( 0 ), 0U );
+   ASSERT_EQ( pp.size( 1 ), 2U );
+   ASSERT_EQ( pp.size( 2 ), 1U );
+   ASSERT_EQ( pp.pop( 1 ), 10 );
+   ASSERT_EQ( pp.pop( 1 ), 40 );
+   ASSERT_EQ( pp.pop( 2 ), 20 );
+   ASSERT_EQ( pp.size(), 0U );
+}
+
+TEST_F(PartitionedPoolTest, test_rebalance_moves_bucket) {
+
+   // 2 lanes with 16 buckets each: keys 0 and 2 are in lane 0.
+   rebalancing_ppool pp( 2, csize );
+   for( int i( 0 ); i < 10; ++i ) {
+      pp.push( 0, i );
+   }
+   for( int i( 0 ); i < 6; ++i ) {
+      pp.push( 2, i );
+   }
+   ASSERT_EQ( pp.size( 0 ), 16U );
+   for( int i( 0 ); i < 16; ++i ) {
+      pp.pop( 0 );
+   }
+   pp.processed( 0 );
+
+   // One bucket of lane 0 goes to lane 1.
+   ASSERT_TRUE( pp.rebalance() );
+   pp.push( 0, 1 );
+   pp.push( 2, 1 );
+   ASSERT_EQ( pp.size( 0 ), 1U );
+   ASSERT_EQ( pp.size( 1 ), 1U );
+   // Nothing pushed since the last rebalance.
+   ASSERT_FALSE( pp.rebalance() );
+}
+
+TEST_F(PartitionedPoolTest, test_rebalance_gives_up) {
+
+   // Lane 0 is not consumed: its buckets can not be moved.
+   rebalancing_ppool pp( 2, csize );
+   for( int i( 0 ); i < 10; ++i ) {
+      pp.push( 0, i );
+   }
+   for( int i( 0 ); i < 6; ++i ) {
+      pp.push( 2, i );
+   }
+   ASSERT_FALSE( pp.rebalance( std::chrono::milliseconds( 10 ) ) );
+
+   // The buckets stay in lane 0.
+   pp.push( 0, 10 );
+   pp.push( 2, 6 );
+   ASSERT_EQ( pp.size( 0 ), 18U );
+   ASSERT_EQ( pp.size( 1 ), 0U );
+}
+
+TEST_F(PartitionedPoolTest, test_key_order_with_rebalancing) {
+
+   std::size_t const lanes( 3 );
+   int const keys( 64 );
+   int const per_key( 300 );
+   rebalancing_ppool pp( lanes, csize );
+   pp.register_terminator();
+   pp.start();
+
+   // Per key: the last processed value; a key must never be processed
+   // by two lanes at the same time, so the values come in order.
+   std::vector< std::atomic< int > > last( keys );
+   for( std::atomic< int > & l : last ) {
+      l = -1;
+   }
+   std::atomic< bool > in_order( true );
+
+   std::vector< std::thread > consumers;
+   for( std::size_t lane( 0 ); lane < lanes; ++lane ) {
+      consumers.emplace_back( [&, lane]() {
+            while( true ) {
+               ptl::object_pool::pop_result< int > r(
+                  pp.pop_or_closed( lane ) );
+               if( not r ) {
+                  break;
+               }
+               int const key( *r / per_key );
+               int const value( *r % per_key );
+               if( last[ key ].load() != value - 1 ) {
+                  in_order = false;
+               }
+               last[ key ].store( value );
+            }
+         } );
+   }
+
+   std::atomic< bool > done( false );
+   std::thread rebalancer( [&]() {
+         while( not done ) {
+            pp.rebalance();
+            std::this_thread::yield();
+         }
+      } );
+
+   // Keys 0 .. 15 are busier than the others.
+   for( int v( 0 ); v < per_key; ++v ) {
+      for( int k( 0 ); k < keys; ++k ) {
+         if( k < 16 or v < per_key / 4 ) {
+            pp.push( k, k * per_key + v );
+         }
+      }
+   }
+   pp.terminate();
+   for( std::thread & t : consumers ) {
+      t.join();
+   }
+   done = true;
+   rebalancer.join();
+
+   ASSERT_TRUE( in_order );
+}
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
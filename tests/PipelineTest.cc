@@ -0,0 +1,177 @@
+#include <ptl/pipeline.hh>
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <gtest/gtest.h>
+
+class PipelineTest : public ::testing::Test {
+public:
+};
+
+template< typename OBJ_TYPE >
+using lfqueue = ptl::object_pool::pool<
+   OBJ_TYPE,
+   ptl::object_pool::policies::threading::lock_free,
+   ptl::object_pool::policies::notify::one,
+   ptl::object_pool::policies::notify::one,
+   ptl::object_pool::policies::termination::terminatable,
+   ptl::object_pool::policies::container::mpmc_ring,
+   ptl::object_pool::policies::size_handling::constant >;
+
+ptl::object_pool::policies::size_handling::constant csize( 8 );
+
+TEST_F(PipelineTest, test_single_stage) {
+
+   std::vector< int > seen;
+   ptl::pipeline::pipeline< int > p(
+      ptl::pipeline::builder< int >()
+      .sink( "collect", 1, csize, [&seen]( int i ) { seen.push_back( i ); } )
+      .build() );
+   p.register_terminator();
+   p.start();
+   for( int i( 0 ); i < 100; ++i ) {
+      p.push( i );
+   }
+   p.terminate();
+   p.join();
+   ASSERT_EQ( seen.size(), 100U );
+   for( int i( 0 ); i < 100; ++i ) {
+      ASSERT_EQ( seen[ i ], i );
+   }
+}
+
+TEST_F(PipelineTest, test_typed_stages_and_stats) {
+
+   std::atomic< long > sum( 0 );
+   ptl::pipeline::pipeline< int > p(
+      ptl::pipeline::builder< int >()
+      .stage< std::string >( "format", 3, csize,
+                             []( int i ) { return std::to_string( i ); } )
+      .stage< long, lfqueue >( "parse", 2, csize,
+                               []( std::string const & s ) {
+                                  return std::stol( s ); }, 4 )
+      .sink( "sum", 2, csize, [&sum]( long l ) { sum += l; } )
+      .build() );
+
+   // Two producers.
+   p.register_terminator();
+   p.register_terminator();
+   p.start();
+   std::thread t1( [&p]() {
+         for( int i( 1 ); i <= 500; ++i ) {
+            p.push( i );
+         }
+         p.terminate();
+      } );
+   std::thread t2( [&p]() {
+         std::vector< int > batch;
+         for( int i( 501 ); i <= 1000; ++i ) {
+            batch.push_back( i );
+         }
+         p.push_bulk( batch );
+         p.terminate();
+      } );
+   t1.join();
+   t2.join();
+   p.join();
+   ASSERT_EQ( sum, 500500 );
+
+   std::vector< ptl::pipeline::stage_stats > const stats( p.stats() );
+   ASSERT_EQ( stats.size(), 3U );
+   ASSERT_EQ( stats[ 0 ].name, "format" );
+   ASSERT_EQ( stats[ 0 ].workers, 3U );
+   ASSERT_EQ( stats[ 1 ].name, "parse" );
+   ASSERT_EQ( stats[ 2 ].name, "sum" );
+   for( ptl::pipeline::stage_stats const & s : stats ) {
+      ASSERT_EQ( s.processed, 1000U );
+      ASSERT_EQ( s.depth, 0U );
+      ASSERT_GT( s.throughput(), 0.0 );
+   }
+}
+
+TEST_F(PipelineTest, test_move_only_objects) {
+
+   std::atomic< int > sum( 0 );
+   ptl::pipeline::pipeline< int > p(
+      ptl::pipeline::builder< int >()
+      .stage< std::unique_ptr< int > >(
+         "box", 2, csize,
+         []( int i ) { return std::unique_ptr< int >( new int( i ) ); } )
+      .sink( "unbox", 2, csize,
+             [&sum]( std::unique_ptr< int > && i ) { sum += *i; } )
+      .build() );
+   p.register_terminator();
+   p.start();
+   for( int i( 1 ); i <= 100; ++i ) {
+      p.push( i );
+   }
+   p.terminate();
+   p.join();
+   ASSERT_EQ( sum, 5050 );
+}
+
+TEST_F(PipelineTest, test_ordered_stage) {
+
+   std::vector< int > seen;
+   ptl::pipeline::pipeline< int > p(
+      ptl::pipeline::builder< int >()
+      .ordered_stage< int >( "square", 4, csize,
+                             []( int i ) {
+                                // Later objects are faster.
+                                std::this_thread::sleep_for(
+                                   std::chrono::microseconds(
+                                      ( 7 - i % 8 ) * 50 ) );
+                                return i * i; },
+                             4, 2 )
+      .sink( "collect", 1, csize, [&seen]( int i ) { seen.push_back( i ); } )
+      .build() );
+   p.register_terminator();
+   p.start();
+   std::vector< int > batch;
+   for( int i( 0 ); i < 200; ++i ) {
+      if( i < 100 ) {
+         p.push( i );
+      } else {
+         batch.push_back( i );
+      }
+   }
+   p.push_bulk( batch );
+   p.terminate();
+   p.join();
+   ASSERT_EQ( seen.size(), 200U );
+   for( int i( 0 ); i < 200; ++i ) {
+      ASSERT_EQ( seen[ i ], i * i );
+   }
+}
+
+TEST_F(PipelineTest, test_reorder_buffer_window) {
+
+   ptl::pipeline::detail::reorder_buffer< int > rb( 2 );
+   std::vector< int > released;
+   auto const release( [&released]( std::vector< int > & r ) {
+         released.insert( released.end(), r.begin(), r.end() ); } );
+
+   rb.put( 1, 1, release );
+   ASSERT_TRUE( released.empty() );
+   // 2 is out of the window until 0 is released.
+   std::atomic< bool > put_2( false );
+   std::thread t( [&]() {
+         rb.put( 2, 2, release );
+         put_2 = true;
+      } );
+   std::this_thread::sleep_for( std::chrono::milliseconds( 20 ) );
+   // No ASSERT while t runs: returning early would not join it.
+   EXPECT_FALSE( put_2 );
+   rb.put( 0, 0, release );
+   t.join();
+   ASSERT_EQ( released, std::vector< int >( { 0, 1, 2 } ) );
+}
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
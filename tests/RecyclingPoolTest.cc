@@ -0,0 +1,152 @@
+#include <ptl/object_pool/recycling.hh>
+
+#include <thread>
+#include <atomic>
+#include <vector>
+#include <gtest/gtest.h>
+
+class RecyclingPoolTest : public ::testing::Test {
+public:
+};
+
+// Counts the living instances.
+class Buffer {
+public:
+   Buffer() {
+      ++created;
+      ++alive;
+   }
+
+   ~Buffer() {
+      --alive;
+   }
+
+   void clear() {
+      data.clear();
+   }
+
+   std::vector< char > data;
+
+   static std::atomic_long created;
+   static std::atomic_long alive;
+};
+
+std::atomic_long Buffer::created( 0 );
+std::atomic_long Buffer::alive( 0 );
+
+using depot_pool = ptl::object_pool::recycling_pool<
+   Buffer,
+   ptl::object_pool::policies::factory::default_construct< Buffer >,
+   ptl::object_pool::policies::reset::clear,
+   ptl::object_pool::policies::cache::none >;
+
+using magazine_pool = ptl::object_pool::recycling_pool< Buffer >;
+
+TEST_F(RecyclingPoolTest, test_recycle) {
+
+   Buffer::created = 0;
+   {
+      depot_pool dp( 10 );
+      Buffer * first( nullptr );
+      {
+         depot_pool::handle h( dp.acquire() );
+         ASSERT_TRUE( static_cast< bool >( h ) );
+         first = h.get();
+         h->data.resize( 1000 );
+      }
+      ASSERT_EQ( dp.idle(), 1U );
+      depot_pool::handle h( dp.acquire() );
+      ASSERT_EQ( h.get(), first );
+      // reset::clear was called: the memory is kept.
+      ASSERT_TRUE( h->data.empty() );
+      ASSERT_GE( h->data.capacity(), 1000U );
+      ASSERT_EQ( dp.idle(), 0U );
+   }
+   ASSERT_EQ( Buffer::created.load(), 1 );
+   ASSERT_EQ( Buffer::alive.load(), 0 );
+}
+
+TEST_F(RecyclingPoolTest, test_max_idle) {
+
+   Buffer::created = 0;
+   {
+      depot_pool dp( 3 );
+      {
+         std::vector< depot_pool::handle > hs;
+         for( int i( 0 ); i < 10; ++i ) {
+            hs.push_back( dp.acquire() );
+         }
+         ASSERT_EQ( Buffer::alive.load(), 10 );
+      }
+      ASSERT_EQ( dp.idle(), 3U );
+      ASSERT_EQ( Buffer::alive.load(), 3 );
+   }
+   ASSERT_EQ( Buffer::created.load(), 10 );
+   ASSERT_EQ( Buffer::alive.load(), 0 );
+}
+
+TEST_F(RecyclingPoolTest, test_handle_move_and_reset) {
+
+   magazine_pool mp( 10 );
+   magazine_pool::handle h1( mp.acquire() );
+   magazine_pool::handle h2( std::move( h1 ) );
+   ASSERT_FALSE( static_cast< bool >( h1 ) );
+   ASSERT_TRUE( static_cast< bool >( h2 ) );
+   h2.reset();
+   ASSERT_FALSE( static_cast< bool >( h2 ) );
+   ASSERT_EQ( mp.idle(), 1U );
+}
+
+TEST_F(RecyclingPoolTest, test_magazines_many_threads) {
+
+   Buffer::created = 0;
+   {
+      magazine_pool mp( 64 );
+      std::shared_ptr< std::thread > ts[8];
+      for( int i( 0 ); i < 8; ++i ) {
+         ts[ i ] = std::make_shared< std::thread >( [&mp]() {
+               for( int j( 0 ); j < 10000; ++j ) {
+                  magazine_pool::handle h1( mp.acquire() );
+                  magazine_pool::handle h2( mp.acquire() );
+                  h1->data.push_back( 'a' );
+                  h2->data.push_back( 'b' );
+               }
+            } );
+      }
+      for( int i( 0 ); i < 8; ++i ) {
+         ts[ i ]->join();
+      }
+      // Each thread uses at most two objects at the same time.
+      ASSERT_LT( Buffer::created.load(), 8 * 2 * 32 );
+   }
+   ASSERT_EQ( Buffer::alive.load(), 0 );
+}
+
+TEST_F(RecyclingPoolTest, test_magazines_max_idle) {
+
+   Buffer::created = 0;
+   {
+      magazine_pool mp( 40 );
+      std::shared_ptr< std::thread > ts[8];
+      for( int i( 0 ); i < 8; ++i ) {
+         ts[ i ] = std::make_shared< std::thread >( [&mp]() {
+               std::vector< magazine_pool::handle > hs;
+               for( int j( 0 ); j < 50; ++j ) {
+                  hs.push_back( mp.acquire() );
+               }
+            } );
+      }
+      for( int i( 0 ); i < 8; ++i ) {
+         ts[ i ]->join();
+      }
+      // The magazines count against max_idle, too.
+      ASSERT_LE( mp.idle(), 40U );
+      ASSERT_LE( Buffer::alive.load(), 40 );
+   }
+   ASSERT_EQ( Buffer::alive.load(), 0 );
+}
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
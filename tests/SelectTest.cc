@@ -0,0 +1,141 @@
+#include <ptl/object_pool/select.hh>
+
+#include <chrono>
+#include <string>
+#include <thread>
+#include <gtest/gtest.h>
+
+class SelectTest : public ::testing::Test {
+public:
+};
+
+template< typename OBJ_TYPE >
+using mtqueue = ptl::object_pool::pool<
+   OBJ_TYPE,
+   ptl::object_pool::policies::threading::multi,
+   ptl::object_pool::policies::notify::one,
+   ptl::object_pool::policies::notify::selectable,
+   ptl::object_pool::policies::termination::terminatable,
+   ptl::object_pool::policies::container::queue,
+   ptl::object_pool::policies::size_handling::constant >;
+
+template< typename OBJ_TYPE >
+using lfqueue = ptl::object_pool::pool<
+   OBJ_TYPE,
+   ptl::object_pool::policies::threading::lock_free,
+   ptl::object_pool::policies::notify::one,
+   ptl::object_pool::policies::notify::selectable,
+   ptl::object_pool::policies::termination::terminatable,
+   ptl::object_pool::policies::container::mpmc_ring,
+   ptl::object_pool::policies::size_handling::constant >;
+
+ptl::object_pool::policies::size_handling::constant csize( 100 );
+
+TEST_F(SelectTest, test_timeout) {
+
+   mtqueue< int > p1( csize );
+   lfqueue< std::string > p2( csize );
+   ptl::object_pool::selector s;
+   s.add( p1 );
+   s.add( p2 );
+   ASSERT_EQ( s.wait_for( std::chrono::milliseconds( 10 ) ),
+              ptl::object_pool::select_timeout );
+}
+
+TEST_F(SelectTest, test_priority_order) {
+
+   mtqueue< int > control( csize );
+   lfqueue< std::string > data( csize );
+   ptl::object_pool::selector s;
+   std::size_t const ci( s.add( control ) );
+   std::size_t const di( s.add( data ) );
+
+   data.push( "d" );
+   ASSERT_EQ( s.wait(), di );
+   control.push( 1 );
+   // Both are ready: control was added first.
+   ASSERT_EQ( s.wait(), ci );
+   ASSERT_EQ( *control.try_pop(), 1 );
+   ASSERT_EQ( s.wait(), di );
+   ASSERT_EQ( *data.try_pop(), "d" );
+}
+
+TEST_F(SelectTest, test_round_robin_order) {
+
+   mtqueue< int > p1( csize );
+   mtqueue< int > p2( csize );
+   ptl::object_pool::selector s( ptl::object_pool::select_order::round_robin );
+   std::size_t const i1( s.add( p1 ) );
+   std::size_t const i2( s.add( p2 ) );
+
+   for( int i( 0 ); i < 2; ++i ) {
+      p1.push( i );
+      p2.push( i );
+   }
+   ASSERT_EQ( s.wait(), i1 );
+   ASSERT_EQ( s.wait(), i2 );
+   ASSERT_EQ( s.wait(), i1 );
+}
+
+TEST_F(SelectTest, test_wakeup_from_other_threads) {
+
+   mtqueue< int > p1( csize );
+   lfqueue< std::string > p2( csize );
+   p1.register_terminator();
+   p1.start();
+   p2.register_terminator();
+   p2.start();
+
+   ptl::object_pool::selector s;
+   std::size_t const i1( s.add( p1 ) );
+   std::size_t const i2( s.add( p2 ) );
+
+   std::thread t1( [&p1]() {
+         for( int i( 0 ); i < 1000; ++i ) {
+            p1.push( i );
+         }
+         p1.terminate();
+      } );
+   std::thread t2( [&p2]() {
+         for( int i( 0 ); i < 1000; ++i ) {
+            p2.push( std::to_string( i ) );
+         }
+         p2.terminate();
+      } );
+
+   int n1( 0 );
+   int n2( 0 );
+   int closed( 0 );
+   while( closed < 2 ) {
+      std::size_t const i( s.wait() );
+      if( i == i1 ) {
+         ptl::object_pool::pop_result< int > r( p1.try_pop() );
+         if( r ) {
+            ASSERT_EQ( *r, n1 );
+            ++n1;
+         } else if( r.status() == ptl::object_pool::pop_status::closed ) {
+            s.remove( i1 );
+            ++closed;
+         }
+      } else {
+         ASSERT_EQ( i, i2 );
+         ptl::object_pool::pop_result< std::string > r( p2.try_pop() );
+         if( r ) {
+            ASSERT_EQ( *r, std::to_string( n2 ) );
+            ++n2;
+         } else if( r.status() == ptl::object_pool::pop_status::closed ) {
+            s.remove( i2 );
+            ++closed;
+         }
+      }
+   }
+   t1.join();
+   t2.join();
+   ASSERT_EQ( n1, 1000 );
+   ASSERT_EQ( n2, 1000 );
+}
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,143 @@
+#include <ptl/object_pool/sharded.hh>
+
+#include <thread>
+#include <atomic>
+#include <gtest/gtest.h>
+
+class ShardedPoolTest : public ::testing::Test {
+public:
+};
+
+template< typename OBJ_TYPE >
+using mtqueue = ptl::object_pool::pool<
+   OBJ_TYPE,
+   ptl::object_pool::policies::threading::multi,
+   ptl::object_pool::policies::notify::one,
+   ptl::object_pool::policies::notify::one,
+   ptl::object_pool::policies::termination::terminatable,
+   ptl::object_pool::policies::container::queue,
+   ptl::object_pool::policies::size_handling::constant >;
+
+template< typename OBJ_TYPE >
+using lfqueue = ptl::object_pool::pool<
+   OBJ_TYPE,
+   ptl::object_pool::policies::threading::lock_free,
+   ptl::object_pool::policies::notify::one,
+   ptl::object_pool::policies::notify::one,
+   ptl::object_pool::policies::termination::terminatable,
+   ptl::object_pool::policies::container::mpmc_ring,
+   ptl::object_pool::policies::size_handling::constant >;
+
+ptl::object_pool::policies::size_handling::constant csize( 777 );
+
+TEST_F(ShardedPoolTest, test_push_and_pop_local) {
+
+   ptl::object_pool::sharded_pool< mtqueue< int > > spi( 4, csize );
+   ASSERT_EQ( spi.shards(), 4U );
+   for( int i( 0 ); i < 10; ++i ) {
+      spi.push( i );
+   }
+   ASSERT_EQ( spi.size(), 10U );
+   for( int i( 0 ); i < 10; ++i ) {
+      ASSERT_EQ( spi.pop(), i );
+   }
+   ASSERT_EQ( spi.size(), 0U );
+}
+
+TEST_F(ShardedPoolTest, test_steal) {
+
+   ptl::object_pool::sharded_pool< lfqueue< int > > spi( 4, csize );
+   spi.push_at( 2, 7 );
+   // Shard 0 is empty: steal from shard 2
+   ASSERT_EQ( spi.pop_at( 0 ), 7 );
+}
+
+TEST_F(ShardedPoolTest, test_overflow_into_other_shard) {
+
+   ptl::object_pool::policies::size_handling::constant const csize1( 1 );
+   ptl::object_pool::sharded_pool< mtqueue< int > > spi( 2, csize1 );
+   spi.push_at( 0, 1 );
+   // Shard 0 is full: the object goes to shard 1
+   spi.push_at( 0, 2 );
+   ASSERT_EQ( spi.pop_at( 1 ), 2 );
+   ASSERT_EQ( spi.pop_at( 1 ), 1 );
+}
+
+TEST_F(ShardedPoolTest, test_terminate) {
+
+   ptl::object_pool::sharded_pool< mtqueue< int > > spi( 3, csize );
+   spi.register_terminator();
+   spi.start();
+   spi.push_at( 1, 7 );
+   spi.terminate();
+   ASSERT_TRUE( spi.should_terminate() );
+   ASSERT_EQ( spi.pop_at( 0 ), 7 );
+   ASSERT_EQ( spi.pop_or_closed().status(),
+              ptl::object_pool::pop_status::closed );
+   ASSERT_THROW( spi.pop(), ptl::object_pool::terminate_except );
+}
+
+template< typename POOL >
+void many_producers_many_consumers() {
+   ptl::object_pool::policies::size_handling::constant const csize16( 16 );
+   ptl::object_pool::sharded_pool< POOL > sp( 4, csize16 );
+   std::atomic_long overall_cnt( 0 );
+   std::atomic_long overall_sum( 0 );
+
+   std::shared_ptr< std::thread > t_recvs[8];
+   std::shared_ptr< std::thread > t_sends[4];
+
+   for( int i( 0 ); i < 4; ++i ) {
+      sp.register_terminator();
+   }
+
+   for( int i( 0 ); i < 8; ++i ) {
+      t_recvs[ i ] = std::make_shared< std::thread >(
+         [&sp, &overall_cnt, &overall_sum]() {
+            while( true ) {
+               ptl::object_pool::pop_result< long > r(
+                  sp.pop_or_closed() );
+               if( not r ) {
+                  break;
+               }
+               overall_sum += *r;
+               ++overall_cnt;
+            }
+         } );
+   }
+
+   sp.start();
+
+   for( int i( 0 ); i < 4; ++i ) {
+      t_sends[ i ] = std::make_shared< std::thread >(
+         [&sp]() {
+            for( long j( 0 ); j < 10000; ++j ) {
+               sp.push( j );
+            }
+            sp.terminate();
+         } );
+   }
+
+   for( int i( 0 ); i < 4; ++i ) {
+      t_sends[ i ]->join();
+   }
+   for( int i( 0 ); i < 8; ++i ) {
+      t_recvs[ i ]->join();
+   }
+
+   ASSERT_EQ( overall_cnt.load(), 40000 );
+   ASSERT_EQ( overall_sum.load(), 4 * ( 9999L * 10000L / 2 ) );
+}
+
+TEST_F(ShardedPoolTest, test_many_producers_many_consumers) {
+   many_producers_many_consumers< mtqueue< long > >();
+}
+
+TEST_F(ShardedPoolTest, test_lock_free_many_producers_many_consumers) {
+   many_producers_many_consumers< lfqueue< long > >();
+}
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
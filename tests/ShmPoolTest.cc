@@ -0,0 +1,128 @@
+#include <ptl/object_pool/shm.hh>
+
+#include <string>
+#include <stdexcept>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <gtest/gtest.h>
+
+class ShmPoolTest : public ::testing::Test {
+public:
+};
+
+template< typename OBJ_TYPE >
+using shmqueue = ptl::object_pool::pool<
+   OBJ_TYPE,
+   ptl::object_pool::policies::threading::process_shared,
+   ptl::object_pool::policies::notify::futex,
+   ptl::object_pool::policies::notify::futex,
+   ptl::object_pool::policies::termination::terminatable,
+   ptl::object_pool::policies::container::shm_ring,
+   ptl::object_pool::policies::size_handling::constant >;
+
+using shm_mode = ptl::object_pool::policies::threading::process_shared::mode;
+
+class Point {
+public:
+   int x;
+   int y;
+};
+
+// A name which is unique for this process and test.
+std::string shm_name( std::string const & test ) {
+   return "/ptl_shm_pool_test_" + std::to_string( getpid() ) + "_" + test;
+}
+
+TEST_F(ShmPoolTest, test_push_and_pop_between_two_mappings) {
+
+   ptl::object_pool::policies::size_handling::constant const csize( 4 );
+   std::string const name( shm_name( "two_mappings" ) );
+   shmqueue< Point > creator( csize, name, shm_mode::create );
+   shmqueue< Point > opener( csize, name, shm_mode::open );
+
+   creator.push( Point { 1, 2 } );
+   creator.push( Point { 3, 4 } );
+   ASSERT_EQ( opener.size(), 2U );
+   Point const p( opener.pop() );
+   ASSERT_EQ( p.x, 1 );
+   ASSERT_EQ( p.y, 2 );
+   ASSERT_EQ( creator.pop().x, 3 );
+   ASSERT_TRUE( not opener.try_pop() );
+}
+
+TEST_F(ShmPoolTest, test_open_with_different_size_fails) {
+
+   std::string const name( shm_name( "different_size" ) );
+   shmqueue< int > creator(
+      ptl::object_pool::policies::size_handling::constant( 4 ),
+      name, shm_mode::create );
+   ASSERT_THROW(
+      shmqueue< int >(
+         ptl::object_pool::policies::size_handling::constant( 8 ),
+         name, shm_mode::open ),
+      std::runtime_error );
+}
+
+TEST_F(ShmPoolTest, test_open_missing_segment_fails) {
+
+   ASSERT_THROW(
+      shmqueue< int >(
+         ptl::object_pool::policies::size_handling::constant( 4 ),
+         shm_name( "missing" ), shm_mode::open ),
+      std::system_error );
+}
+
+TEST_F(ShmPoolTest, test_producer_and_consumer_process) {
+
+   // Small: the producer has to wait for the consumer.
+   ptl::object_pool::policies::size_handling::constant const csize( 3 );
+   std::string const name( shm_name( "processes" ) );
+   long const count( 10000 );
+   shmqueue< long > pool( csize, name, shm_mode::create );
+   pool.register_terminator();
+
+   pid_t const child( fork() );
+   ASSERT_GE( child, 0 );
+   if( child == 0 ) {
+      // Consumer: only _exit() - the test framework belongs to the
+      // parent.
+      int rval( 0 );
+      try {
+         shmqueue< long > consumer( csize, name, shm_mode::open );
+         long expected( 0 );
+         while( true ) {
+            ptl::object_pool::pop_result< long > r(
+               consumer.pop_or_closed() );
+            if( not r ) {
+               break;
+            }
+            if( *r != expected ) {
+               rval = 1;
+            }
+            ++expected;
+         }
+         if( expected != count ) {
+            rval = 2;
+         }
+      } catch( ... ) {
+         rval = 3;
+      }
+      _exit( rval );
+   }
+
+   pool.start();
+   for( long i( 0 ); i < count; ++i ) {
+      pool.push( i );
+   }
+   pool.terminate();
+
+   int status( 0 );
+   ASSERT_EQ( waitpid( child, &status, 0 ), child );
+   ASSERT_TRUE( WIFEXITED( status ) );
+   ASSERT_EQ( WEXITSTATUS( status ), 0 );
+}
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}